@@ -0,0 +1 @@
+# Debug profile: no optimisation, tracing and the profiler are built in. This is the default.
@@ -0,0 +1,39 @@
+# Default kernel configuration, the profiles in this directory override single values of it.
+# Every CONFIG_ variable is written into the generated config.h as a define of the same name.
+
+# Optimisation level and debugging information
+OPT = -O0 -g
+
+# Slow clock cycles (32768 Hz) between two ticks of the Period Interval Timer, a power of two
+CONFIG_TICK_PERIOD = 32
+
+# Ticks a thread may run before it is preempted
+CONFIG_TIME_SLOT = 3
+
+# Maximum number of threads, including the idle thread, at most 32 as the translation tables of
+# the threads must fit below the user library
+CONFIG_MAX_THREADS = 32
+
+# Sizes of the DBGU input and output buffers in bytes
+CONFIG_DBGU_INPUT_BUFFER = 512
+CONFIG_DBGU_OUTPUT_BUFFER = 4096
+
+# Size of the kernel heap in bytes, it shares the internal RAM with the exception stacks and
+# must not exceed 4096
+CONFIG_KMEM_SIZE = 3072
+
+# Pages (1 MB each) the idle thread keeps zeroed for new user memory, at least 1
+CONFIG_ZERO_POOL = 4
+
+# Optional subsystems, each is compiled out entirely if it is 0
+
+# Tracing of kernel events and the number of records in its ring buffer (a power of two)
+CONFIG_TRACE = 1
+CONFIG_TRACE_SIZE = 256
+
+# The sampling profiler and the number of samples in its buffer (a power of two)
+CONFIG_PROFILE = 1
+CONFIG_PROFILE_SIZE = 4096
+
+# Measurement of the interrupt latency and of IRQ-disabled sections
+CONFIG_LATENCY = 0
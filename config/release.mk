@@ -0,0 +1,7 @@
+# Release profile: optimised for speed without any debugging aids.
+
+OPT = -O2
+
+CONFIG_TRACE = 0
+CONFIG_PROFILE = 0
+CONFIG_LATENCY = 0
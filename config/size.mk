@@ -0,0 +1,11 @@
+# Size profile: optimised for size with smaller buffers and without any debugging aids.
+
+OPT = -Os
+
+CONFIG_MAX_THREADS = 16
+CONFIG_DBGU_INPUT_BUFFER = 128
+CONFIG_DBGU_OUTPUT_BUFFER = 1024
+
+CONFIG_TRACE = 0
+CONFIG_PROFILE = 0
+CONFIG_LATENCY = 0
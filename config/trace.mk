@@ -0,0 +1,9 @@
+# Trace profile: optimised like the release profile, but with all measurements built in and a
+# larger trace buffer, to observe the system as it runs in production.
+
+OPT = -O2 -g
+
+CONFIG_TRACE = 1
+CONFIG_TRACE_SIZE = 1024
+CONFIG_PROFILE = 1
+CONFIG_LATENCY = 1
@@ -6,21 +6,65 @@
  */
 
 
+#include "lib/inttypes.h"
+
+
 #ifndef AIC_H_
 #define AIC_H_
 
 
-/* BEGIN Functions to interact with the hardware directly */
+#define AIC_SOURCES             32
+
+#define AIC_SOURCE_FIQ          0   // Fast Interrupt Input
+#define AIC_SOURCE_SYS          1   // System Peripherals (ST, RTC, PMC, DBGU ...)
+
+#define AIC_PRIO_LOWEST         0
+#define AIC_PRIO_HIGHEST        7
 
-void aic_enable_system_peripherals(void);
+#define AIC_TRIGGER_LEVEL       0
+#define AIC_TRIGGER_EDGE        1
+
+
+/* BEGIN Functions to interact with the hardware directly */
 
 void aic_clear_system_peripherals(void);
 
-void aic_read_ivr(void);
+uint32_t aic_read_ivr(void);
 
 void aic_end_of_interrupt(void);
 
 /* END Functions to interact with the hardware directly */
 
 
+/* BEGIN Functions abstracting direct hardware access */
+
+/**
+ * Initializes the AIC, i.e. disables and clears all sources and sets the spurious interrupt vector.
+ * 
+ * @param spurious  The handler returned by the AIC when there is no interrupt to serve
+ */
+void aic_init(void (*spurious)(void));
+
+/**
+ * Registers a handler for an interrupt source and enables the source.
+ * The handler is programmed into the source's vector register and returned by aic_read_ivr()
+ * whenever this source is the pending source with the highest priority.
+ * 
+ * @param source    The interrupt source (peripheral ID)
+ * @param prio      The priority level, from AIC_PRIO_LOWEST to AIC_PRIO_HIGHEST
+ * @param trigger   AIC_TRIGGER_LEVEL or AIC_TRIGGER_EDGE
+ * @param handler   The handler for the source
+ */
+void aic_register(uint8_t source, uint8_t prio, uint8_t trigger, void (*handler)(void));
+
+/**
+ * Disables an interrupt source and removes its handler.
+ * 
+ * @param source    The interrupt source (peripheral ID)
+ */
+void aic_unregister(uint8_t source);
+
+/* END Functions abstracting direct hardware access */
+
+
 #endif /* AIC_H_ */
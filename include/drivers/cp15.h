@@ -16,6 +16,21 @@
 #define CP15_H_
 
 
+// The geometry of the data cache (16 KB in 8 segments of 64 lines of 32 bytes each)
+#define CP15_CACHE_LINE_SIZE            32
+#define CP15_DCACHE_SIZE                (16 * 1024)
+#define CP15_DCACHE_SEGMENTS            8
+#define CP15_DCACHE_INDICES             64
+
+// The number of entries in each of the TLBs, the lockdown registers hold a 6 bit base and victim
+#define CP15_TLB_ENTRIES                64
+
+// The fault types in the Fault Status Register
+#define CP15_FSR_TYPE                   0x0F
+#define CP15_FSR_TRANSLATION_SECTION    0x05
+#define CP15_FSR_PERMISSION_SECTION     0x0D
+
+
 /* BEGIN Functions for MMU, domain access and TTB management */
 
 /**
@@ -40,6 +55,13 @@ void cp15_init_domains(void);
  */
 void cp15_write_translation_table_base(uint32_t* ptr);
 
+/**
+ * Reads the address of the translation table base from the MMU.
+ * 
+ * @return          The address of the TTB
+ */
+uint32_t* cp15_read_translation_table_base(void);
+
 /* END Functions for MMU, domain access and TTB management */
 
 
@@ -80,6 +102,53 @@ void cp15_invalidate_icache(void);
  */
 void cp15_invalidate_caches(void);
 
+/**
+ * Cleans the data cache line that holds a given virtual address, i.e. writes it back to memory.
+ * 
+ * @param address   The virtual address
+ */
+void cp15_clean_dcache_entry(uint32_t address);
+
+/**
+ * Invalidates the data cache line that holds a given virtual address without writing it back.
+ * 
+ * @param address   The virtual address
+ */
+void cp15_invalidate_dcache_entry(uint32_t address);
+
+/**
+ * Cleans and invalidates the data cache line that holds a given virtual address.
+ * 
+ * @param address   The virtual address
+ */
+void cp15_clean_invalidate_dcache_entry(uint32_t address);
+
+/**
+ * Invalidates the instruction cache line that holds a given virtual address.
+ * 
+ * @param address   The virtual address
+ */
+void cp15_invalidate_icache_entry(uint32_t address);
+
+/**
+ * Cleans and invalidates the whole data cache by walking all of its segments and indices.
+ */
+void cp15_clean_invalidate_dcache(void);
+
+/**
+ * Cleans and invalidates the data cache lines that hold a range of virtual addresses. Ranges of at
+ * least the cache's size are handled by cleaning the whole cache, which takes fewer operations.
+ * 
+ * @param address   The first address of the range
+ * @param size      The size of the range in bytes
+ */
+void cp15_clean_invalidate_dcache_range(uint32_t address, uint32_t size);
+
+/**
+ * Waits until the write buffer has written all pending stores to memory.
+ */
+void cp15_drain_write_buffer(void);
+
 /* END Functions for cache management */
 
 
@@ -100,6 +169,51 @@ void cp15_invalidate_itlb(void);
  */
 void cp15_invalidate_tlb(void);
 
+/**
+ * Invalidates the data Translation Lookaside Buffer's entry for a given virtual address.
+ * 
+ * @param address   The virtual address
+ */
+void cp15_invalidate_dtlb_entry(uint32_t address);
+
+/**
+ * Invalidates the instruction Translation Lookaside Buffer's entry for a given virtual address.
+ * 
+ * @param address   The virtual address
+ */
+void cp15_invalidate_itlb_entry(uint32_t address);
+
+/**
+ * Invalidates the entries for a given virtual address in both Translation Lookaside Buffers.
+ * 
+ * @param address   The virtual address
+ */
+void cp15_invalidate_tlb_entry(uint32_t address);
+
+/**
+ * Loads the translation of a virtual address into the data TLB and locks the entry down, i.e. it
+ * survives invalidations of the whole TLB and is never chosen as a victim again.
+ * The MMU has to be enabled and the address must be readable without side effects.
+ * One entry is always left unlocked for the translations that are not locked down.
+ * 
+ * @param address   The virtual address
+ * 
+ * @return          1 iff the entry is locked down, 0 if there is no entry left to lock
+ */
+uint8_t cp15_lock_dtlb_entry(uint32_t address);
+
+/**
+ * Loads the translation of a virtual address into the instruction TLB and locks the entry down,
+ * i.e. it survives invalidations of the whole TLB and is never chosen as a victim again.
+ * The MMU has to be enabled.
+ * One entry is always left unlocked for the translations that are not locked down.
+ * 
+ * @param address   The virtual address
+ * 
+ * @return          1 iff the entry is locked down, 0 if there is no entry left to lock
+ */
+uint8_t cp15_lock_itlb_entry(uint32_t address);
+
 /* END Functions for TLB management */
 
 
@@ -110,6 +224,12 @@ void cp15_invalidate_tlb(void);
  */
 uint32_t cp15_read_fault_address(void);
 
+/**
+ * Returns the Fault Status Register of the last data abort, i.e. the fault type in bits 3:0 and
+ * the domain of the accessed section in bits 7:4.
+ */
+uint32_t cp15_read_fault_status(void);
+
 /* END Functions for fault management */
 
 
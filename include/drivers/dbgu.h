@@ -55,6 +55,15 @@ void dbgu_txrdy_interrupt_disable(void);
  */
 void dbgu_write_string(char* string);
 
+/**
+ * Writes a buffer into the DBGU by writing single bytes into the Transmit Holding Register until
+ * all bytes have been sent.
+ * 
+ * @param bytes     A pointer to the buffer
+ * @param size      The size of the buffer
+ */
+void dbgu_write_bytes(uint8_t* bytes, size_t size);
+
 /**
  * Reads a single character from the DBGU that is being held in the Receive Holding Register.
  * This function uses polling to determine whether there is a character to be read.
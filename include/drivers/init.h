@@ -32,6 +32,28 @@
 #define ARM_MODE_SYS    0b11111 | I_BIT | F_BIT
 
 
+// Defined by the linker script
+extern uint32_t __iram_load;
+extern uint32_t __iram_start;
+extern uint32_t __iram_end;
+
+
+
+/**
+ * Copies the code that is linked to the internal RAM from its load address in the external RAM.
+ * This has to be done before any of it is called, i.e. before any interrupt or syscall is handled.
+ */
+__attribute__((always_inline))
+inline void init_iram(void) {
+
+    uint32_t* src = &__iram_load;
+    uint32_t* dst = &__iram_start;
+
+    while (dst < &__iram_end) {
+        *(dst++) = *(src++);
+    }
+
+}
 
 /**
  * Creates Interrupt Vector Table.
@@ -46,6 +68,7 @@ inline void init_ivt(void) {
     *(ivt++)        = LOAD_PC;
     *(ivt++)        = LOAD_PC;
     *(ivt++)        = LOAD_PC;
+    *(ivt++)        = LOAD_PC;
     *(ivt)          = LOAD_PC;
 
     uint32_t* ivt_big = (uint32_t*) (INT_RAM + ISR_OFFSET);
@@ -54,8 +77,9 @@ inline void init_ivt(void) {
     *(ivt_big++)    = (uint32_t) &isr_software_interrupt;
     *(ivt_big++)    = (uint32_t) &isr_prefetch_abort;
     *(ivt_big++)    = (uint32_t) &isr_data_abort;
-    *(ivt_big++)    = (uint32_t) &isr_fast_interrupt_request;
-    *(ivt_big)      = (uint32_t) &isr_interrupt_request;
+    *(ivt_big++)    = (uint32_t) &isr_reset;                    // reserved vector
+    *(ivt_big++)    = (uint32_t) &isr_interrupt_request;
+    *(ivt_big)      = (uint32_t) &isr_fast_interrupt_request;
 
     mc_toggle_remap();
 
@@ -89,7 +113,7 @@ inline void init_stacks(void) {
     // Place all interrupt mode stacks at the end of the internal RAM.
     init_stack_pointer(ARM_MODE_FIQ, 0x00204000);
     init_stack_pointer(ARM_MODE_IRQ, 0x00204C00);
-    init_stack_pointer(ARM_MODE_SVC, 0x00204800);
+    init_stack_pointer(ARM_MODE_SVC, INTERRUPT_SVC_STACK);
     init_stack_pointer(ARM_MODE_ABT, 0x00204400);
     init_stack_pointer(ARM_MODE_UND, 0x00203000);
 
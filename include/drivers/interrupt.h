@@ -6,10 +6,27 @@
  */
 
 
+#include "lib/inttypes.h"
+
+
 #ifndef INTERRUPT_H_
 #define INTERRUPT_H_
 
 
+#define INTERRUPT_MODE_MASK     0x1F
+#define INTERRUPT_MODE_USER     0x10
+#define INTERRUPT_MODE_SVC      0x13
+
+// The top of the Supervisor mode stack, system calls start on the empty stack
+#define INTERRUPT_SVC_STACK     0x00204800
+
+// Whether IRQ handlers run with IRQs enabled so that sources of higher priority can preempt them
+#define INTERRUPT_NESTED        1
+
+
+extern uint8_t interrupt_nesting;
+
+
 /* BEGIN Interrupt Service Routines */
 
 /**
@@ -25,37 +42,101 @@ void isr_undefined(void);
 
 /**
  * Software Interrupt (SWI)
+ * System calls that neither block nor switch threads are handled on a fast path that only saves the
+ * registers clobbered by a function call, the others save the thread's full context.
  */
-__attribute__ ((interrupt ("SWI")))
+__attribute__ ((naked))
 void isr_software_interrupt(void);
 
 /**
  * Prefetch Abort
  */
-__attribute__ ((interrupt ("ABORT")))
+__attribute__ ((naked))
 void isr_prefetch_abort(void);
 
 /**
  * Data Abort
  */
-__attribute__ ((interrupt ("ABORT")))
+__attribute__ ((naked))
 void isr_data_abort(void);
 
 /**
  * Fast Interrupt Request (FIQ)
+ * The Fast Interrupt Input is not routed to any device, so this is never expected to run.
  */
 __attribute__ ((interrupt ("FIQ")))
 void isr_fast_interrupt_request(void);
 
 /**
  * Interrupt Request (IRQ)
+ * If the IRQ has interrupted a thread or the boot code, its context is saved into the current
+ * context, which the handler may change by switching threads. If it has interrupted another IRQ
+ * handler or deferred work, only the registers clobbered by the handler are saved on the stack.
  */
-__attribute__ ((interrupt ("IRQ")))
+__attribute__ ((naked))
 void isr_interrupt_request(void);
 
 /* END Interrupt Service Routines */
 
 
+/* BEGIN Exception handlers called by the Interrupt Service Routines */
+
+/**
+ * Handler for Software Interrupts, dispatches the system call.
+ */
+void interrupt_handle_swi(void);
+
+/**
+ * Handler for Prefetch Aborts, destroys the thread that caused it.
+ */
+void interrupt_handle_prefetch_abort(void);
+
+/**
+ * Handler for Data Aborts, maps reserved sections on their first access, resolves writes to
+ * copy-on-write sections and destroys the thread that caused any other abort.
+ */
+void interrupt_handle_data_abort(void);
+
+/**
+ * Handler for Data Aborts in a privileged mode, maps a reserved section of the current thread that
+ * the kernel accesses on its behalf. Any other abort during a system call terminates the calling
+ * thread and selects the next one, an abort anywhere else halts the kernel.
+ * Privileged writes to copy-on-write sections do not fault, the kernel resolves them beforehand.
+ * 
+ * @param pc        The address of the aborted instruction
+ * @param psr       The PSR of the aborted code
+ * 
+ * @return          0 if the aborted code can be resumed, 1 if the calling thread was terminated
+ */
+uint8_t interrupt_handle_kernel_data_abort(uint32_t pc, uint32_t psr);
+
+/**
+ * Handler for Interrupt Requests, dispatches the AIC source.
+ * 
+ * @param pc        The address of the interrupted instruction
+ * @param psr       The PSR of the interrupted code
+ */
+void interrupt_handle_irq(uint32_t pc, uint32_t psr);
+
+/* END Exception handlers called by the Interrupt Service Routines */
+
+
+/* BEGIN Interrupt handlers for the AIC sources */
+
+/**
+ * Handler for the System Peripherals source (ST, DBGU).
+ * The devices share one AIC source, so it only acknowledges them and defers the actual work.
+ */
+void interrupt_system_peripherals(void);
+
+/**
+ * Handler for spurious interrupts, i.e. when the AIC has no pending source to serve.
+ */
+void interrupt_spurious(void);
+
+/* END Interrupt handlers for the AIC sources */
+
+
 /* BEGIN Functions for specific interrupts */
 
 /**
@@ -88,7 +169,99 @@ void interrupt_enable(void);
  */
 void interrupt_disable(void);
 
+/**
+ * Disables the IRQ signal and returns the previous CPSR.
+ * 
+ * @return          The CPSR before the IRQ signal was disabled
+ */
+uint32_t interrupt_disable_irq_save(void);
+
+/**
+ * Disables the IRQ signal and returns the previous CPSR without starting an IRQ-disabled section of
+ * the latency measurement. For code that returns with IRQs disabled and leaves enabling them to an
+ * exception return, where no interrupt_restore_irq() would end the section.
+ * 
+ * @return          The CPSR before the IRQ signal was disabled
+ */
+uint32_t interrupt_disable_irq_save_raw(void);
+
+/**
+ * Restores the IRQ signal to the state saved in a given CPSR.
+ * 
+ * @param cpsr      The CPSR as returned by interrupt_disable_irq_save()
+ */
+void interrupt_restore_irq(uint32_t cpsr);
+
+/**
+ * Enables the IRQ signal inside an exception handler for work that would keep it disabled for too
+ * long, and returns the previous CPSR. The IRQs taken until interrupt_restore_irq_nested() are
+ * handled as nested ones, so they neither run deferred work nor switch threads. Both are left to
+ * the next outermost IRQ.
+ * 
+ * @return          The CPSR before the IRQ signal was enabled
+ */
+uint32_t interrupt_enable_irq_nested(void);
+
+/**
+ * Restores the IRQ signal to the state saved by interrupt_enable_irq_nested().
+ * 
+ * @param cpsr      The CPSR as returned by interrupt_enable_irq_nested()
+ */
+void interrupt_restore_irq_nested(uint32_t cpsr);
+
 /* END Functions for specific interrupts */
 
 
+/* BEGIN Functions for deferred work */
+
+/**
+ * Calls a function in Supervisor mode with IRQs enabled, on the SVC stack.
+ * The IRQ mode's SPSR and the Supervisor mode's LR are preserved, so the function may be preempted
+ * by another IRQ.
+ * Use only in the IRQ Interrupt Service Routine!
+ * 
+ * @param fn        The function to call
+ */
+void interrupt_call_svc(void (*fn)(void));
+
+/**
+ * Runs all pending deferred work.
+ * If the IRQ has interrupted user mode, the work runs with IRQs enabled, otherwise with IRQs
+ * disabled.
+ * Use only in the IRQ Interrupt Service Routine!
+ */
+void interrupt_run_deferred(void);
+
+/**
+ * Deferred work for the Period Interval Timer: wakes up sleeping threads and requests a thread
+ * switch.
+ */
+void interrupt_work_timer(void);
+
+/**
+ * Deferred work for the Real-time Alarm: wakes up sleeping threads in between two ticks and requests
+ * a thread switch if the idle thread is running.
+ */
+void interrupt_work_alarm(void);
+
+/**
+ * Deferred work while the idle thread runs: zeroes memory in advance, one chunk at a time, until
+ * nothing is left to zero or another thread is ready to run.
+ */
+void interrupt_work_zero(void);
+
+/**
+ * Deferred work for the DBGU receiver: moves all received characters into the input buffer and
+ * resumes threads that are waiting for input.
+ */
+void interrupt_work_dbgu_rx(void);
+
+/**
+ * Deferred work for the DBGU transmitter: writes the next character from the output buffer.
+ */
+void interrupt_work_dbgu_tx(void);
+
+/* END Functions for deferred work */
+
+
 #endif /* INTERRUPT_H_ */
@@ -13,6 +13,15 @@
 #define TIMER_H_
 
 
+// The clock is the Real-time Timer running at the full slow clock (RTPRES = 1), extended to 64 bits
+#define TIMER_CLOCK_HZ          32768
+#define TIMER_CLOCK_WRAP        (1 << 20)
+
+// Bits in the status register as returned by timer_read_status()
+#define TIMER_STATUS_PIT        1 << 0
+#define TIMER_STATUS_ALARM      1 << 3
+
+
 /* BEGIN Functions to interact with the hardware directly */
 
 void timer_init_periodical(uint16_t slck_period);
@@ -25,11 +34,66 @@ uint32_t timer_read_PIT_status(void);
 
 uint32_t timer_read_RTTINC_status(void);
 
+uint32_t timer_read_real_time(void);
+
+void timer_alarm_enable(uint32_t value);
+
+void timer_alarm_disable(void);
+
 /* END Functions to interact with the hardware directly */
 
 
 /* BEGIN Functions abstracting direct hardware access */
 
+/**
+ * Returns the monotonic clock, i.e. the number of slow clock cycles since the Real-time Timer has
+ * been started.
+ * This has to be called at least once per wrap-around of the Real-time Timer (32 s).
+ * 
+ * @return          The clock in units of 1/TIMER_CLOCK_HZ seconds
+ */
+uint64_t timer_read_clock(void);
+
+/**
+ * Converts a clock value into nanoseconds.
+ * 
+ * @param clock     The clock value
+ * 
+ * @return          The clock value in nanoseconds
+ */
+uint64_t timer_clock_to_ns(uint64_t clock);
+
+/**
+ * Converts a clock value into milliseconds, rounded down.
+ * 
+ * @param clock     The clock value
+ * 
+ * @return          The clock value in milliseconds
+ */
+uint32_t timer_clock_to_ms(uint64_t clock);
+
+/**
+ * Converts milliseconds into a clock value, rounded up.
+ * 
+ * @param ms        The number of milliseconds
+ * 
+ * @return          The clock value that spans at least the given time
+ */
+uint64_t timer_ms_to_clock(uint32_t ms);
+
+/**
+ * Sets the alarm to a given clock value, or disables it if the value is not within the next
+ * wrap-around of the Real-time Timer.
+ * 
+ * @param clock     The clock value at which the alarm should fire
+ */
+void timer_set_alarm(uint64_t clock);
+
+/**
+ * Busy-waits for a given amount of time.
+ * 
+ * @param ms        The number of milliseconds to wait
+ */
 void timer_clksleep(uint16_t ms);
 
 /* END Functions abstracting direct hardware access */
@@ -27,9 +27,10 @@
 #define INT_RAM_LEN         (16 * KB)
 #define USB_HOST_IFACE      0x00300000
 
+// One bit per page of the external RAM
 #define ALLOC_TABLE         (INT_RAM + INT_RAM_LEN - 2*KB)
-#define ALLOC_TABLE_LEN     (2 * 4)
-#define ALLOC_TABLE_ENTRIES 2
+#define ALLOC_TABLE_ENTRIES (EXT_RAM_LEN / PAGE_SIZE / 32)
+#define ALLOC_TABLE_LEN     (ALLOC_TABLE_ENTRIES * 4)
 
 #define TTB_FIRST_ADDR      (EXT_RAM + 512 * KB)
 
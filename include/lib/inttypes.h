@@ -23,8 +23,8 @@
 #define uint32_t        unsigned int
 #define int32_t         int
 
-#define uint64_t        unsigned long
-#define int64_t         long
+#define uint64_t        unsigned long long
+#define int64_t         long long
 
 #define size_t          unsigned int
 
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Application library for reading the kernel information page without system calls.
+ */
+
+
+#include "lib/inttypes.h"
+
+
+#ifndef LIB_KINFO_H_
+#define LIB_KINFO_H_
+
+
+// The kernel information page is mapped read-only at the same address into every address space
+#define KINFO_ADDR      0x20200000
+
+
+/**
+ * The struct of the kernel information page.
+ * The kernel increments `seq` before and after every update, i.e. it is odd while an update is in
+ * progress. Readers have to retry if it is odd or has changed while they were reading.
+ * 
+ * @field seq       The sequence counter
+ * @field ticks     The number of Period Interval Timer ticks since boot
+ * @field time      The monotonic time at the last tick in ns, i.e. with the granularity of a tick
+ * @field tid       The ID of the thread that is currently running
+ * @field switches  The number of thread switches since boot
+ * @field idle      The number of ticks the idle thread has been running
+ */
+struct kinfo {
+    uint32_t seq;
+    uint32_t ticks;
+    uint64_t time;
+    uint32_t tid;
+    uint32_t switches;
+    uint32_t idle;
+};
+
+
+/**
+ * Reads a consistent snapshot of the kernel information page.
+ * 
+ * @param info      Pointer to the struct to copy the snapshot into
+ */
+void kinfo_read(struct kinfo* info);
+
+/**
+ * Returns the number of Period Interval Timer ticks since boot.
+ * 
+ * @return          The number of ticks
+ */
+uint32_t kinfo_ticks(void);
+
+/**
+ * Returns the monotonic time at the last tick. It has the granularity of a tick, as the user cannot
+ * read the System Timer to add the time since then. clock_gettime() returns the exact time with a
+ * system call.
+ * 
+ * @return          The time in ns
+ */
+uint64_t kinfo_time(void);
+
+/**
+ * Returns the ID of the current thread.
+ * 
+ * @return          The current thread's ID
+ */
+uint32_t kinfo_tid(void);
+
+
+#endif /* LIB_KINFO_H_ */
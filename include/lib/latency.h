@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Application library for reading the kernel's interrupt latency statistics.
+ */
+
+
+#include "lib/inttypes.h"
+
+
+#ifndef LIB_LATENCY_H_
+#define LIB_LATENCY_H_
+
+
+// Number of histogram buckets, bucket 0 counts durations below one clock cycle and bucket i > 0
+// durations from 2^(i-1) to 2^i - 1 cycles
+#define LATENCY_BUCKETS     16
+
+// Number of call sites whose IRQ-disabled sections are tracked
+#define LATENCY_SITES       8
+
+
+/**
+ * The longest IRQ-disabled sections of a call site.
+ * 
+ * @field site      The address the section was started from, i.e. the caller of
+ *                  interrupt_disable_irq_save() or the handler of an exception
+ * @field count     The number of sections started from the site
+ * @field max       The longest section in clock cycles
+ */
+struct latency_site {
+    uint32_t site;
+    uint32_t count;
+    uint32_t max;
+};
+
+/**
+ * The interrupt latency statistics. All durations are in cycles of the slow clock (about 30.5 us).
+ * 
+ * @field irq_hist  Histogram of the time from a Period Interval Timer tick to its handler
+ * @field irq_max   The longest time from a tick to its handler
+ * @field off_hist  Histogram of the durations of IRQ-disabled sections
+ * @field off_max   The longest IRQ-disabled section
+ * @field sites     The call sites of the longest IRQ-disabled sections, unused entries are 0
+ */
+struct latency_report {
+    uint32_t irq_hist[LATENCY_BUCKETS];
+    uint32_t irq_max;
+    uint32_t off_hist[LATENCY_BUCKETS];
+    uint32_t off_max;
+    struct latency_site sites[LATENCY_SITES];
+};
+
+
+/**
+ * Reads the kernel's interrupt latency statistics, which are only collected if the kernel has been
+ * built with CONFIG_LATENCY (e.g. with the trace profile), all zero otherwise.
+ * 
+ * @param report    Pointer to the struct to write the statistics into
+ * @param reset     Whether the statistics should be cleared afterwards
+ * 
+ * @return          0 on success, -1 if the struct is not writable user memory
+ */
+int32_t latency_read(struct latency_report* report, uint8_t reset);
+
+
+#endif /* LIB_LATENCY_H_ */
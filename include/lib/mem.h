@@ -30,13 +30,4 @@ void memcopy(uint8_t* dst, uint8_t* src, size_t size);
  */
 void memzero(uint8_t* dst, size_t size);
 
-/**
- * Maps a memory segment to the given address.
- * 
- * @param addr  The address to be mapped
- * 
- * @return      Whether the mapping was successful
- */
-uint32_t mmap(uint32_t addr);
-
 #endif /* MEM_H_ */
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Application library for mapping memory into the address space.
+ */
+
+
+#include "lib/inttypes.h"
+
+
+#ifndef MMAN_H_
+#define MMAN_H_
+
+
+// The protection bits, the MMU of the ARM920T cannot prevent the execution of readable memory
+#define PROT_NONE   0x00
+#define PROT_READ   0x01
+#define PROT_WRITE  0x02
+#define PROT_EXEC   0x04
+
+#define MAP_FIXED   0x01
+
+#define MAP_FAILED  ((void*) 0)
+
+
+/**
+ * The memory an address space uses and the limit it is held to. Pages and sections are 1 MB each.
+ * 
+ * @field resident  The pages mapped into the address space, shared ones included
+ * @field shared    Of those, the pages shared with other address spaces since a fork
+ * @field reserved  The sections that are mapped but do not have a page until their first access
+ * @field limit     The most sections the address space may have mapped (resident or reserved),
+ *                  0 if there is no limit
+ * @field kernel    The bytes of kernel memory taken up by the address space's translation table
+ *                  and bookkeeping
+ * @field free      The pages that are still free in the whole system
+ */
+struct mem_stats {
+    uint32_t resident;
+    uint32_t shared;
+    uint32_t reserved;
+    uint32_t limit;
+    uint32_t kernel;
+    uint32_t free;
+};
+
+
+/**
+ * Maps memory into the address space. The mapping covers all sections that the range touches,
+ * they are allocated and zeroed on their first access.
+ * 
+ * @param addr      With MAP_FIXED the address to map at, otherwise where to start looking for
+ *                  free sections
+ * @param length    The length of the range in bytes
+ * @param prot      The protection bits (PROT_*)
+ * @param flags     The flags (MAP_*)
+ * 
+ * @return          `addr` with MAP_FIXED, the first address of the mapping otherwise, or
+ *                  MAP_FAILED if there was an error
+ */
+void* mmap(void* addr, size_t length, uint32_t prot, uint32_t flags);
+
+/**
+ * Unmaps all sections a range of mapped memory touches and frees their pages.
+ * 
+ * @param addr      The first address of the range
+ * @param length    The length of the range in bytes
+ * 
+ * @return          1 iff the range could be unmapped, 0 otherwise
+ */
+uint32_t munmap(void* addr, size_t length);
+
+/**
+ * Changes the protection of all sections a range of mapped memory touches.
+ * 
+ * @param addr      The first address of the range
+ * @param length    The length of the range in bytes
+ * @param prot      The new protection bits (PROT_*)
+ * 
+ * @return          1 iff the protection could be changed, 0 otherwise
+ */
+uint32_t mprotect(void* addr, size_t length, uint32_t prot);
+
+/**
+ * Reads the memory usage of the calling thread's address space.
+ * 
+ * @param stats     Pointer to the struct to write the usage into
+ * 
+ * @return          0 on success, -1 if the struct is not writable user memory
+ */
+int32_t mem_stats(struct mem_stats* stats);
+
+/**
+ * Limits the sections the calling thread's address space may have mapped, resident or reserved.
+ * Mappings beyond the limit fail, and processes created afterwards inherit it. The limit is a hard
+ * one: once set, it can only be lowered.
+ * 
+ * @param sections  The new limit
+ * 
+ * @return          1 iff the limit was set, 0 if it would be raised or removed
+ */
+uint32_t mem_limit(uint32_t sections);
+
+
+#endif /* MMAN_H_ */
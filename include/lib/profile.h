@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Application library for the sampling profiler.
+ */
+
+
+#include "lib/inttypes.h"
+
+
+#ifndef LIB_PROFILE_H_
+#define LIB_PROFILE_H_
+
+
+/**
+ * A sample of the code that was interrupted by a tick of the Period Interval Timer.
+ * 
+ * @field pc        The address of the interrupted instruction
+ * @field tid       The ID of the thread that was running
+ * @field mode      The processor mode of the interrupted code (e.g. 0x10 = User, 0x13 = Supervisor)
+ */
+struct profile_sample {
+    uint32_t pc;
+    uint16_t tid;
+    uint16_t mode;
+};
+
+
+/**
+ * Discards all samples and starts sampling on every tick.
+ */
+void profile_start(void);
+
+/**
+ * Stops sampling, the samples taken so far can still be read.
+ */
+void profile_stop(void);
+
+/**
+ * Moves the oldest samples out of the kernel's sample buffer.
+ * 
+ * @param samples   Pointer to the array to write the samples into
+ * @param max       The number of entries in the array
+ * 
+ * @return          The number of samples written, -1 if the array is not writable user memory
+ */
+uint32_t profile_read(struct profile_sample* samples, uint32_t max);
+
+
+#endif /* LIB_PROFILE_H_ */
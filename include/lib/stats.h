@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Application library for reading scheduler statistics.
+ */
+
+
+#include "lib/inttypes.h"
+
+
+#ifndef STATS_H_
+#define STATS_H_
+
+
+/**
+ * The struct holding a snapshot of a thread's statistics.
+ * 
+ * @field id                The thread ID
+ * @field parent_id         The parent thread's ID
+ * @field status            The thread's status
+ * @field switches_vol      The number of times the thread has given up the processor itself
+ * @field switches_invol    The number of times the thread has been preempted
+ * @field wakeups           The number of times the thread has been woken up after blocking
+ * @field run_time          The time the thread has been running in ns
+ * @field ready_time        The time the thread has been ready but waiting for the processor in ns
+ */
+struct thread_stats {
+    uint32_t id;
+    uint32_t parent_id;
+    uint32_t status;
+    uint32_t switches_vol;
+    uint32_t switches_invol;
+    uint32_t wakeups;
+    uint64_t run_time;
+    uint64_t ready_time;
+};
+
+
+/**
+ * Takes a snapshot of the statistics of all threads.
+ * 
+ * @param stats     Pointer to the array to write the snapshot into
+ * @param max       The number of entries in the array
+ * 
+ * @return          The number of entries written, -1 if the array is not writable user memory
+ */
+uint32_t thread_stats(struct thread_stats* stats, uint32_t max);
+
+
+#endif /* STATS_H_ */
@@ -26,12 +26,12 @@ __attribute__((format(printf, 1, 2)))
 int printf(const char* format, ...);
 
 /**
- * Writes a given number of bytes into the standard output.
+ * Reads a given number of bytes from the standard input.
  * 
- * @param source    Pointer to the buffer to write bytes from
- * @param size      The number of bytes to write
+ * @param target    Pointer to the buffer to read bytes to
+ * @param size      The number of bytes to read
  * 
- * @return          The number of bytes written
+ * @return          The number of bytes read, 0xFFFFFFFF if the buffer is not writable user memory
  */
 size_t read_string(char*, size_t);
 
@@ -48,12 +48,13 @@ void read_flush(void);
 char getc(void);
 
 /**
- * Reads a given number of bytes from the standard input.
+ * Writes a given number of bytes into the standard output.
  * 
- * @param target    Pointer to the buffer to read bytes to
- * @param size      The number of bytes to read
+ * @param source    Pointer to the buffer to write bytes from
+ * @param size      The number of bytes to write
  * 
- * @return          The number of bytes read
+ * @return          The number of bytes written, 0xFFFFFFFF if the buffer is not readable user
+ *                  memory
  */
 size_t write_string(char*, size_t);
 
@@ -29,7 +29,7 @@ void exit(int32_t status);
  * @param param1    The first parameter the new thread's function should be launched with
  * @param param2    The second parameter the new thread's function should be launched with
  * 
- * @return          The new thread's ID
+ * @return          The new thread's ID, 0xFFFFFFFF if it could not be created
  */
 uint32_t launch(void* text, uint32_t param1, uint32_t param2);
 
@@ -40,10 +40,18 @@ uint32_t launch(void* text, uint32_t param1, uint32_t param2);
  * @param param1    The first parameter the new task thread's function should be launched with
  * @param param2    The second parameter the new task thread's function should be launched with
  * 
- * @return          The new task thread's ID
+ * @return          The new task thread's ID, 0xFFFFFFFF if it could not be created
  */
 uint32_t launch_task(void* text, uint32_t param1, uint32_t param2);
 
+/**
+ * Creates a copy of the calling thread in a new address space. Both continue after the call, the
+ * copy's memory is shared with the caller's until one of them writes to it.
+ * 
+ * @return          The copy's ID in the caller, 0 in the copy, -1 if there was an error
+ */
+int32_t fork(void);
+
 /**
  * Puts a thread to sleep for a given time.
  * 
@@ -54,7 +62,38 @@ uint32_t launch_task(void* text, uint32_t param1, uint32_t param2);
  */
 uint32_t sleep(uint32_t ms);
 
+/**
+ * Yields the processor to the next thread that is ready to run.
+ * Returns immediately if there is no such thread.
+ */
+void yield(void);
+
+/**
+ * Returns the ID of the current thread.
+ * 
+ * @return          The current thread's ID
+ */
+uint32_t gettid(void);
+
+/**
+ * Returns the monotonic time since boot with the resolution of the slow clock (about 30 us).
+ * 
+ * @return          The time in ns
+ */
+uint64_t clock_gettime(void);
+
 /* END Thread management functions */
 
 
+/* BEGIN Debugging functions */
+
+/**
+ * Writes the kernel's trace buffer to the DBGU in binary, see tools/trace_decode.py.
+ * The whole system stalls while the trace is written.
+ */
+void dump_trace(void);
+
+/* END Debugging functions */
+
+
 #endif /* STDLIB_H_ */
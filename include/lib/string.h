@@ -13,6 +13,10 @@
 #define STRING_H_
 
 
+// Maximum number of arguments interpolate_va() passes on
+#define INTERPOLATE_MAX_ARGS    32
+
+
 /**
  * Writes a given number as its hex representation into a given target buffer. 
  * 
@@ -25,7 +29,8 @@ void to_hex(char* target, uint32_t arg);
  * Interpolates a format string with given arguments and writes it into a given target buffer.
  * cur_arg points to the location of the first argument.
  * This function is not meant to be used on its own to avoid mistakes with the addresses.
- * Use a variate function that wraps around it instead, e.g. printf() or interpolate().
+ * Use a variate function that wraps around it instead, e.g. printf() or interpolate(), or
+ * interpolate_va().
  * 
  * @param target    Pointer to the target buffer for the interpolated string
  * @param cap       Capacity of the target buffer
@@ -37,6 +42,21 @@ void to_hex(char* target, uint32_t arg);
  */
 size_t interpolate_core(char* target, size_t cap, const char* format, void* cur_arg);
 
+/**
+ * Interpolates a format string with the arguments of a variate function and writes it into a given
+ * target buffer.
+ * The arguments are collected into a consecutive memory area for interpolate_core(), as only
+ * unoptimised builds happen to leave them there. At most INTERPOLATE_MAX_ARGS arguments are used.
+ * 
+ * @param target    Pointer to the target buffer for the interpolated string
+ * @param cap       Capacity of the target buffer
+ * @param format    Pointer to the format string
+ * @param args      The variate function's arguments after the format string
+ * 
+ * @return          The number of characters in the interpolated string (including null terminator)
+ */
+size_t interpolate_va(char* target, size_t cap, const char* format, __builtin_va_list args);
+
 /**
  * Interpolates a format string with given arguments and writes it into a given target buffer.
  * This is a wrapper around interpolate_core() so we can call it as a variate function.
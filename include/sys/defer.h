@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Functions for deferred work (bottom halves) that is scheduled by Interrupt Service Routines.
+ */
+
+
+#include "lib/inttypes.h"
+
+
+#ifndef DEFER_H_
+#define DEFER_H_
+
+
+#define DEFER_TIMER         0
+#define DEFER_DBGU_RX       1
+#define DEFER_DBGU_TX       2
+#define DEFER_ALARM         3
+#define DEFER_ZERO          4
+
+
+extern volatile uint32_t defer_pending;
+
+
+/**
+ * Marks a deferred work item as pending.
+ * Use only in Interrupt Service Routines, i.e. with IRQs disabled!
+ * 
+ * @param work      The ID of the deferred work item
+ */
+__attribute__((always_inline))
+inline void defer_raise(uint8_t work) {
+    defer_pending |= 1 << work;
+}
+
+/**
+ * Runs all pending deferred work items until none are left.
+ * The work items themselves run with the IRQ state this function was called with, new work raised
+ * by interrupts in the meantime is picked up before returning.
+ * 
+ * This function always returns with IRQs disabled.
+ */
+void defer_run(void);
+
+
+/* BEGIN Deferred work management tables */
+
+extern void* defer_functions[];
+
+/* END Deferred work management tables */
+
+
+#endif /* DEFER_H_ */
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Functions for the kernel information page that is mapped read-only into every address space.
+ */
+
+
+#include "lib/inttypes.h"
+#include "lib/kinfo.h"
+
+
+#ifndef KINFO_H_
+#define KINFO_H_
+
+
+/**
+ * Initializes the kernel information page.
+ */
+void kinfo_init(void);
+
+/**
+ * Publishes a Period Interval Timer tick.
+ * 
+ * @param time      The current monotonic time in ns
+ * @param tid       The ID of the thread that has been running during the tick
+ */
+void kinfo_tick(uint64_t time, uint32_t tid);
+
+/**
+ * Publishes a thread switch.
+ * 
+ * @param tid       The ID of the thread that runs from now on
+ */
+void kinfo_switch(uint32_t tid);
+
+
+#endif /* KINFO_H_ */
@@ -6,14 +6,15 @@
  */
 
 
+#include "config.h"
 #include "lib/inttypes.h"
 
 
 #ifndef KMEM_H_
 #define KMEM_H_
 
-#define KMEM_START  INT_RAM + KB
-#define KMEM_SIZE   11 * KB
+#define KMEM_START  INT_RAM + 8 * KB
+#define KMEM_SIZE   CONFIG_KMEM_SIZE
 
 
 /**
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Functions for measuring the interrupt latency and the durations of IRQ-disabled sections.
+ */
+
+
+#include "config.h"
+#include "drivers/util.h"
+#include "lib/inttypes.h"
+#include "lib/latency.h"
+
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+
+// Whether the latency is measured, the hooks and statistics compile to nothing otherwise. The
+// measurements read the Real-time Timer on every transition of the IRQ signal, so this is only on
+// in the trace profile.
+#define LATENCY_ENABLED     CONFIG_LATENCY
+
+
+/**
+ * Starts measuring the latency of the Period Interval Timer's ticks.
+ * Call right after the Period Interval Timer has been started.
+ * 
+ * @param pit_period    The period of the Period Interval Timer in slow clock cycles, must be a power
+ *                      of two
+ */
+void latency_init(uint32_t pit_period);
+
+/**
+ * Records the time from the last tick of the Period Interval Timer until now.
+ */
+void latency_record_tick(void);
+
+/**
+ * Marks the start of an IRQ-disabled section.
+ * 
+ * @param site      The address the section is started from
+ */
+void latency_section_begin(void* site);
+
+/**
+ * Marks the end of the current IRQ-disabled section and records its duration.
+ */
+void latency_section_end(void);
+
+/**
+ * Copies the statistics, which are all zero if the latency is not measured.
+ * 
+ * @param report    Pointer to the struct to write the statistics into
+ * @param reset     Whether the statistics should be cleared afterwards
+ */
+void latency_copy(struct latency_report* report, uint8_t reset);
+
+/**
+ * Records the latency of a tick of the Period Interval Timer if the latency is measured.
+ * Use only in the handler that acknowledges the tick!
+ */
+__attribute__((always_inline))
+inline void latency_tick(void) {
+#if LATENCY_ENABLED
+    latency_record_tick();
+#endif
+}
+
+/**
+ * Marks the start of an IRQ-disabled section if the latency is measured.
+ * 
+ * @param site      The address the section is started from
+ */
+__attribute__((always_inline))
+inline void latency_irqs_off(void* site) {
+#if LATENCY_ENABLED
+    latency_section_begin(site);
+#else
+    UNUSED(site);
+#endif
+}
+
+/**
+ * Marks the end of the current IRQ-disabled section if the latency is measured.
+ */
+__attribute__((always_inline))
+inline void latency_irqs_on(void) {
+#if LATENCY_ENABLED
+    latency_section_end();
+#endif
+}
+
+
+#endif /* LATENCY_H_ */
@@ -6,7 +6,10 @@
  */
 
 
+#include "config.h"
+#include "drivers/util.h"
 #include "lib/inttypes.h"
+#include "lib/mman.h"
 
 
 #ifndef MEMMGMT_H_
@@ -15,6 +18,73 @@
 
 #define MEMMGMT_TTB_ENTRIES 4096
 
+// The first pages in RAM are reserved for the kernel, the user library and the kernel information page
+#define MEMMGMT_RESERVED_PAGES  3
+
+// The domain that marks copy-on-write sections, they are read-only for the user
+#define MEMMGMT_DOMAIN_COW      1
+
+// Sections at the end of the (unused) flash area that are remapped to copy pages
+#define MEMMGMT_SCRATCH_SRC     0x1FE00000
+#define MEMMGMT_SCRATCH_DST     0x1FF00000
+
+// An address in the section of the system peripherals (AIC, DBGU, PMC, ST) that can be read
+// without side effects (AIC_SMR0)
+#define MEMMGMT_PERIPHERALS     0xFFFFF000
+
+// The part of the address space user mappings are placed in, the task threads' stacks lie above
+#define MEMMGMT_MMAP_START      (EXT_RAM + 5*MB)
+#define MEMMGMT_MMAP_END        0xE0000000
+
+// The end of the user part of the address space, the stacks grow down from here
+#define MEMMGMT_USER_END        0xF0000000
+
+// Every thread that is not a task has an address space of its own
+#define MEMMGMT_MAX_SPACES      CONFIG_MAX_THREADS
+
+// Each thread ID has a 16 KB translation table slot between TTB_FIRST_ADDR and the user library
+#define MEMMGMT_TTB_SLOTS       ((0x20100000 - TTB_FIRST_ADDR) / (16*KB))
+
+#if MEMMGMT_MAX_SPACES > MEMMGMT_TTB_SLOTS
+#error "CONFIG_MAX_THREADS exceeds the translation table slots below the user library"
+#endif
+
+// Pages zeroed in advance, and the bytes zeroed at a time while refilling them, a thread that
+// becomes ready waits at most that long for the idle time's zeroing to stop
+#define MEMMGMT_ZERO_POOL       CONFIG_ZERO_POOL
+#define MEMMGMT_ZERO_CHUNK      (64*KB)
+
+// States of the translation table slots, only free dirty slots are zeroed in advance
+#define MEMMGMT_TTB_USED        0
+#define MEMMGMT_TTB_DIRTY       1
+#define MEMMGMT_TTB_ZEROED      2
+
+
+/**
+ * The sections an address space owns, i.e. that it has mapped or reserved for itself, as opposed
+ * to the sections every address space maps the same way.
+ * 
+ * @field summary   One bit per word of `sections`, set iff the word is not 0
+ * @field sections  One bit per translation table entry
+ * @field owned     The number of bits set in `sections`
+ * @field limit     The most sections the address space may own, 0 if there is no limit
+ */
+struct memmgmt_space {
+    uint32_t summary[MEMMGMT_TTB_ENTRIES / 32 / 32];
+    uint32_t sections[MEMMGMT_TTB_ENTRIES / 32];
+    uint32_t owned;
+    uint32_t limit;
+};
+
+
+extern uint8_t memmgmt_page_refs[];
+extern struct memmgmt_space memmgmt_spaces[];
+extern uint16_t memmgmt_zero_pool[];
+extern uint8_t memmgmt_zero_pool_num;
+extern uint16_t memmgmt_zero_filling;
+extern uint32_t memmgmt_zero_filled;
+extern uint8_t memmgmt_ttb_state[];
+
 
 /* BEGIN Translation and resolving functions */
 
@@ -74,9 +144,108 @@ void memmgmt_init_page_table(uint16_t page);
  */
 void memmgmt_init_allocation_table(void);
 
+/**
+ * Initializes the zeroing in advance: the pool is empty and the contents of all translation table
+ * slots are unknown.
+ */
+void memmgmt_init_zero_pool(void);
+
+/**
+ * Switches to a translation table base and locks the translations of the kernel's sections into
+ * the TLBs: the exception vectors, the internal RAM with the interrupt and system call entry code
+ * and the kernel's stacks, the kernel, the TCB table, the kernel information page and the
+ * peripherals. As every address space maps these the same way, the entries stay valid across
+ * thread switches and survive the TLB invalidation of every address space switch.
+ * 
+ * @param ttb       A pointer to the translation table base to switch to
+ */
+void memmgmt_init_lockdown(uint32_t* ttb);
+
 /* END Initialization functions */
 
 
+/* BEGIN Address space bookkeeping functions */
+
+/**
+ * Returns the bookkeeping of the sections an address space owns.
+ * 
+ * @param ttb       A pointer to the address space's translation table base
+ * 
+ * @return          A pointer to the address space's owned sections
+ */
+struct memmgmt_space* memmgmt_get_space(uint32_t* ttb);
+
+/**
+ * Records that an address space owns the section of a translation table entry.
+ * 
+ * @param ttb       A pointer to the address space's translation table base
+ * @param index     The index of the translation table entry
+ */
+void memmgmt_own(uint32_t* ttb, uint32_t index);
+
+/**
+ * Records that an address space no longer owns the section of a translation table entry.
+ * 
+ * @param ttb       A pointer to the address space's translation table base
+ * @param index     The index of the translation table entry
+ */
+void memmgmt_disown(uint32_t* ttb, uint32_t index);
+
+/**
+ * Finds the next section an address space owns. Skips 32 words of the bitmap at once where the
+ * summary says they are empty, so walking all owned sections costs little more than their number.
+ * 
+ * @param space     A pointer to the address space's owned sections
+ * @param index     The index of the translation table entry to start looking at
+ * 
+ * @return          The index of the next owned section's entry, or -1 if there is none
+ */
+int32_t memmgmt_next_owned(struct memmgmt_space* space, uint32_t index);
+
+/* END Address space bookkeeping functions */
+
+
+/* BEGIN Accounting functions */
+
+/**
+ * Returns whether an address space may own a number of sections more without exceeding its limit.
+ * 
+ * @param ttb       A pointer to the address space's translation table base
+ * @param num       The number of sections to add
+ * 
+ * @return          1 iff the sections are within the limit, 0 otherwise
+ */
+uint8_t memmgmt_within_limit(uint32_t* ttb, uint32_t num);
+
+/**
+ * Sets the most sections an address space may own. Sections it owns already are kept, only new
+ * mappings and reservations are refused. A limit can only be lowered, never raised or removed.
+ * 
+ * @param ttb       A pointer to the address space's translation table base
+ * @param sections  The new limit, 0 for none
+ * 
+ * @return          1 iff the limit was set, 0 otherwise
+ */
+uint8_t memmgmt_set_limit(uint32_t* ttb, uint32_t sections);
+
+/**
+ * Counts the free pages, including the ones zeroed in advance that nobody uses yet.
+ * 
+ * @return          The number of free pages
+ */
+uint32_t memmgmt_count_free_pages(void);
+
+/**
+ * Collects the memory usage of an address space from the sections it owns.
+ * 
+ * @param ttb       A pointer to the address space's translation table base
+ * @param stats     A pointer to the struct to write the usage into
+ */
+void memmgmt_get_stats(uint32_t* ttb, struct mem_stats* stats);
+
+/* END Accounting functions */
+
+
 /* BEGIN Freeing functions */
 
 /**
@@ -87,7 +256,8 @@ void memmgmt_init_allocation_table(void);
 int32_t memmgmt_find_free_page(void);
 
 /**
- * Frees the page with the given index.
+ * Frees the page with the given index. A page that is still shared with other translation tables
+ * only loses one reference.
  * 
  * @param page      The index of the page to free
  * 
@@ -175,6 +345,20 @@ void memmgmt_map_to(uint32_t* ttb, uint32_t from, uint32_t to, uint8_t read, uin
  */
 uint8_t memmgmt_map_any(uint32_t* ttb, uint32_t from, uint8_t read, uint8_t write);
 
+/**
+ * Reserves a section for a virtual address inside a given translation table base without mapping
+ * any physical page yet. The reservation is kept in the (faulting) descriptor itself, the first
+ * access to the section maps a zeroed page to it.
+ * 
+ * @param ttb       A pointer to the translation table base to write the reservation into
+ * @param from      The virtual address
+ * @param read      Whether read permissions are requested
+ * @param write     Whether write permissions are requested
+ * 
+ * @return          1 iff the section was reserved, 0 otherwise
+ */
+uint8_t memmgmt_reserve(uint32_t* ttb, uint32_t from, uint8_t read, uint8_t write);
+
 /**
  * Unmaps a section from a page with a given number inside a given translation table base.
  * 
@@ -186,10 +370,238 @@ void memmgmt_unmap_page(uint32_t* ttb, uint32_t page_num);
 /* END Mapping functions */
 
 
+/* BEGIN Range mapping functions */
+
+/**
+ * Returns whether a range lies within the part of the address space that user mappings may be
+ * placed in.
+ * 
+ * @param address   The first address of the range
+ * @param length    The length of the range in bytes
+ * 
+ * @return          1 iff the range is not empty and within the mapping area, 0 otherwise
+ */
+uint8_t memmgmt_range_valid(uint32_t address, uint32_t length);
+
+/**
+ * Finds a range of free sections in the user mapping area inside a given translation table base,
+ * first looking at and above a hint, then from the start of the area.
+ * 
+ * @param ttb       A pointer to the translation table base to search
+ * @param hint      The index of the section to start looking at
+ * @param num       The number of contiguous free sections needed
+ * 
+ * @return          The index of the first of the sections, or 0 if there are not enough
+ */
+uint32_t memmgmt_find_free_range(uint32_t* ttb, uint32_t hint, uint32_t num);
+
+/**
+ * Maps a range of memory inside a given translation table base. The sections are only reserved,
+ * their pages are mapped on the first access.
+ * 
+ * @param ttb       A pointer to the translation table base to write the mapping into
+ * @param address   With MAP_FIXED the address to map at, otherwise where to start looking for
+ *                  free sections
+ * @param length    The length of the range in bytes
+ * @param prot      The protection bits (PROT_*)
+ * @param flags     The flags (MAP_*)
+ * 
+ * @return          `address` with MAP_FIXED, the first address of the mapping otherwise, or 0 if
+ *                  the range is invalid, already (partly) mapped or beyond the address space's
+ *                  limit
+ */
+uint32_t memmgmt_map_range(uint32_t* ttb, uint32_t address, uint32_t length, uint32_t prot, uint32_t flags);
+
+/**
+ * Unmaps all sections a range of memory touches inside a given translation table base and frees
+ * their pages. Sections that are not mapped are skipped.
+ * 
+ * @param ttb       A pointer to the translation table base to remove the mapping from
+ * @param address   The first address of the range
+ * @param length    The length of the range in bytes
+ * 
+ * @return          1 iff the range is within the user mapping area, 0 otherwise
+ */
+uint8_t memmgmt_unmap_range(uint32_t* ttb, uint32_t address, uint32_t length);
+
+/**
+ * Changes the protection of all sections a range of memory touches inside a given translation
+ * table base. Pages that are shared with other address spaces become copy-on-write sections if
+ * they are made writable.
+ * 
+ * @param ttb       A pointer to the translation table base the range is mapped in
+ * @param address   The first address of the range
+ * @param length    The length of the range in bytes
+ * @param prot      The new protection bits (PROT_*)
+ * 
+ * @return          1 iff the protection was changed, 0 if the range is invalid or not entirely
+ *                  mapped
+ */
+uint8_t memmgmt_protect_range(uint32_t* ttb, uint32_t address, uint32_t length, uint32_t prot);
+
+/* END Range mapping functions */
+
+
+/* BEGIN Page contents functions */
+
+/**
+ * Copies the contents of a page into another one. Both are mapped supervisor-only at the scratch
+ * sections of the current translation table base while copying.
+ * 
+ * @param dst       The index of the page to copy to
+ * @param src       The index of the page to copy from
+ */
+void memmgmt_copy_page(uint16_t dst, uint16_t src);
+
+/**
+ * Fills a block of memory with zeros, eight words at a time.
+ * 
+ * @param to        The first address of the block, word-aligned
+ * @param size      The size of the block in bytes, a multiple of 32
+ */
+void memmgmt_zero_words(uint32_t* to, uint32_t size);
+
+/**
+ * Fills a part of a page with zeros. The page is mapped supervisor-only at a scratch section of the
+ * current translation table base meanwhile.
+ * 
+ * @param page      The index of the page to zero
+ * @param offset    The offset of the part inside the page, a multiple of 32
+ * @param size      The size of the part in bytes, a multiple of 32
+ */
+void memmgmt_zero_page_range(uint16_t page, uint32_t offset, uint32_t size);
+
+/**
+ * Fills a page with zeros. It is mapped supervisor-only at a scratch section of the current
+ * translation table base meanwhile.
+ * 
+ * @param page      The index of the page to zero
+ */
+void memmgmt_zero_page(uint16_t page);
+
+/* END Page contents functions */
+
+
+/* BEGIN Zeroed page pool functions */
+
+/**
+ * Allocates a zeroed page. It comes from the pool the idle thread zeroes in advance, only if the
+ * pool is empty it is zeroed right away.
+ * 
+ * @return          The index of the allocated page, or -1 if there is no free page
+ */
+int32_t memmgmt_allocate_zeroed_page(void);
+
+/**
+ * Allocates a page whose contents are going to be overwritten anyway. The pages zeroed in advance
+ * are only used if no other page is free.
+ * 
+ * @return          The index of the allocated page, or -1 if there is no free page
+ */
+int32_t memmgmt_allocate_any_page(void);
+
+/**
+ * Zeroes the next bit of memory in advance: a free translation table slot that is not zeroed yet,
+ * or else the next chunk of a page for the pool. Every call takes about as long as zeroing one
+ * chunk, so the idle time can be given back to a thread that becomes ready after each of them.
+ * 
+ * @return          1 iff something was zeroed, 0 if there was nothing left to zero
+ */
+uint8_t memmgmt_refill_zero_pool(void);
+
+/* END Zeroed page pool functions */
+
+
+/* BEGIN Demand paging functions */
+
+/**
+ * Maps a zeroed page to a reserved section on its first access.
+ * 
+ * @param ttb       A pointer to the translation table base the section is reserved in
+ * @param address   A virtual address inside the section
+ * 
+ * @return          1 iff the section was reserved and is mapped now, 0 otherwise
+ */
+uint8_t memmgmt_resolve_reserved(uint32_t* ttb, uint32_t address);
+
+/* END Demand paging functions */
+
+
+/* BEGIN Copy-on-write functions */
+
+/**
+ * Shares all pages mapped in a translation table base with another one. Sections the user can
+ * write to become read-only copy-on-write sections in both tables, the first write to one of them
+ * gives the writing address space its own copy. Reserved sections stay reserved in both.
+ * 
+ * @param parent    A pointer to the translation table base to share the pages of
+ * @param child     A pointer to the translation table base to map the pages into
+ */
+void memmgmt_fork(uint32_t* parent, uint32_t* child);
+
+/**
+ * Gives a translation table base its own writable copy of a copy-on-write section. The last
+ * address space that references a page gets write access to it without copying.
+ * 
+ * @param ttb       A pointer to the translation table base the section is mapped in
+ * @param address   A virtual address inside the section
+ * 
+ * @return          1 iff the section was a copy-on-write section and is writable now, 0 otherwise
+ */
+uint8_t memmgmt_resolve_cow(uint32_t* ttb, uint32_t address);
+
+/**
+ * Populates all reserved sections in a range of user memory the kernel is about to access, and
+ * resolves its copy-on-write sections if it is going to write. A fault in the kernel would not be
+ * resolved, and the kernel's own accesses are not checked against the user permissions and would
+ * otherwise write into pages that are still shared.
+ * 
+ * @param ttb       A pointer to the translation table base the range is mapped in
+ * @param address   The first address of the range
+ * @param size      The size of the range in bytes
+ * @param write     Whether the kernel is going to write to the range
+ */
+void memmgmt_prepare_access(uint32_t* ttb, uint32_t address, uint32_t size, uint8_t write);
+
+/**
+ * Returns whether a range lies in user memory that the user may read, i.e. whether every section
+ * it touches is mapped with user read access. This includes the read-only sections of the
+ * libraries and kernel info below MEMMGMT_MMAP_START. Reserved sections do not count before
+ * memmgmt_prepare_access() has resolved them. The kernel must check a buffer it got from the user
+ * with this before reading from it, as its own accesses are not checked against the user
+ * permissions.
+ * 
+ * @param ttb       A pointer to the translation table base the range is mapped in
+ * @param address   The first address of the range
+ * @param size      The size of the range in bytes
+ * 
+ * @return          1 iff the range is empty or the user may read all of it, 0 otherwise
+ */
+uint8_t memmgmt_user_readable(uint32_t* ttb, uint32_t address, uint32_t size);
+
+/**
+ * Returns whether a range lies in user memory that the user may write to, i.e. whether every
+ * section it touches is mapped with user read/write access. Reserved and copy-on-write sections
+ * do not count before memmgmt_prepare_access() has resolved them. The kernel must check a buffer
+ * it got from the user with this before writing to it, as its own accesses are not checked against
+ * the user permissions.
+ * 
+ * @param ttb       A pointer to the translation table base the range is mapped in
+ * @param address   The first address of the range
+ * @param size      The size of the range in bytes
+ * 
+ * @return          1 iff the range is empty or the user may write to all of it, 0 otherwise
+ */
+uint8_t memmgmt_user_writable(uint32_t* ttb, uint32_t address, uint32_t size);
+
+/* END Copy-on-write functions */
+
+
 /* BEGIN Thread management functions */
 
 /**
- * Sets up a thread by allocating a page for its translation table base.
+ * Sets up a thread by allocating a page for its translation table base. The table only needs to be
+ * cleared if the idle thread has not zeroed its slot in advance.
  * 
  * @param id        The thread's ID
  * 
@@ -198,7 +610,8 @@ void memmgmt_unmap_page(uint32_t* ttb, uint32_t page_num);
 uint32_t* memmgmt_setup_thread(uint32_t);
 
 /**
- * Cleans up a thread by freeing all its pages.
+ * Cleans up a thread by freeing all its pages. Only the sections the address space owns are
+ * visited.
  * 
  * @param ttb_addr      A pointer to the first address of the translation table base
  */
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Functions for the sampling profiler driven by the Period Interval Timer.
+ */
+
+
+#include "config.h"
+#include "drivers/util.h"
+#include "lib/inttypes.h"
+#include "lib/profile.h"
+
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+
+// Whether the profiler is built in, it and its buffer compile to nothing otherwise
+#define PROFILE_ENABLED     CONFIG_PROFILE
+
+// Number of samples in the buffer, must be a power of two
+#define PROFILE_SIZE        CONFIG_PROFILE_SIZE
+
+// First word of a dump, "PROF" in little endian
+#define PROFILE_MAGIC       0x464F5250
+
+// The character that starts the profiler or stops it and dumps the samples when it is received by
+// the DBGU (Ctrl-P)
+#define PROFILE_KEY         0x10
+
+
+extern uint8_t profile_active;
+
+
+/**
+ * Discards all samples and starts sampling, or stops sampling.
+ * Does nothing if the profiler is not built in.
+ * 
+ * @param on        1 to start, 0 to stop
+ */
+void profile_enable(uint8_t on);
+
+/**
+ * Stores a sample, drops it if the buffer is full.
+ * 
+ * @param pc        The address of the interrupted instruction
+ * @param psr       The PSR of the interrupted code
+ */
+void profile_record(uint32_t pc, uint32_t psr);
+
+/**
+ * Moves the oldest samples out of the buffer.
+ * Returns no samples if the profiler is not built in.
+ * 
+ * @param samples   Pointer to the array to write the samples into
+ * @param max       The number of entries in the array
+ * 
+ * @return          The number of samples written
+ */
+uint32_t profile_copy(struct profile_sample* samples, uint32_t max);
+
+/**
+ * Writes all samples in the buffer to the DBGU and removes them, bypassing the output buffer.
+ * The dump consists of PROFILE_MAGIC, the number of dropped samples and the number of samples that
+ * follow, then the samples, all in little endian. IRQs are disabled while it is written.
+ */
+void profile_dump(void);
+
+/**
+ * Samples the code interrupted by a tick if the profiler is running.
+ * 
+ * @param pc        The address of the interrupted instruction
+ * @param psr       The PSR of the interrupted code
+ */
+__attribute__((always_inline))
+inline void profile_sample(uint32_t pc, uint32_t psr) {
+#if PROFILE_ENABLED
+    if (profile_active) {
+        profile_record(pc, psr);
+    }
+#else
+    UNUSED(pc);
+    UNUSED(psr);
+#endif
+}
+
+
+#endif /* PROFILE_H_ */
@@ -23,8 +23,21 @@
 #define SWI_THREAD_EXIT     0x21
 #define SWI_THREAD_CREATE   0x22
 #define SWI_THREAD_SLEEP    0x23
+#define SWI_THREAD_ID       0x24
+#define SWI_CLOCK_GETTIME   0x25
+#define SWI_THREAD_STATS    0x26
+#define SWI_THREAD_FORK     0x27
 
 #define SWI_MEM_MAP         0x30
+#define SWI_MEM_UNMAP       0x31
+#define SWI_MEM_PROTECT     0x32
+#define SWI_MEM_STATS       0x33
+#define SWI_MEM_LIMIT       0x34
+
+#define SWI_TRACE_DUMP      0x40
+#define SWI_PROFILE_ENABLE  0x41
+#define SWI_PROFILE_READ    0x42
+#define SWI_LATENCY_READ    0x43
 
 
 /* BEGIN System call functions */
@@ -56,6 +69,8 @@ void swi_thread_create(struct thread_tcb*);
 
 void swi_thread_sleep(struct thread_tcb*);
 
+void swi_thread_fork(struct thread_tcb*);
+
 /* END Thread management system calls */
 
 
@@ -63,15 +78,66 @@ void swi_thread_sleep(struct thread_tcb*);
 
 void swi_mem_map(struct thread_tcb*);
 
+void swi_mem_unmap(struct thread_tcb*);
+
+void swi_mem_protect(struct thread_tcb*);
+
 /* END Memory management system calls */
 
 
+/* BEGIN Debugging system calls */
+
+void swi_trace_dump(struct thread_tcb* tcb);
+
+/* END Debugging system calls */
+
+
+/* BEGIN Fast system call functions */
+
+uint8_t swi_fast_thread_yield(uint32_t* args);
+
+uint8_t swi_fast_thread_id(uint32_t* args);
+
+uint8_t swi_fast_clock_gettime(uint32_t* args);
+
+uint8_t swi_fast_thread_stats(uint32_t* args);
+
+uint8_t swi_fast_profile_enable(uint32_t* args);
+
+uint8_t swi_fast_profile_read(uint32_t* args);
+
+uint8_t swi_fast_mem_stats(uint32_t* args);
+
+uint8_t swi_fast_mem_limit(uint32_t* args);
+
+uint8_t swi_fast_latency_read(uint32_t* args);
+
+/**
+ * Dispatches a system call on the fast path, i.e. without saving the thread's context.
+ * Fast system calls can only read and write their parameters in r7 and r8 and must not block or
+ * switch threads. They return 0 if the call has to be handled on the full path after all.
+ * Use only in the SWI Interrupt Service Routine!
+ * 
+ * @param num       The system call's number
+ * @param args      The saved r7 and r8 of the calling thread
+ * 
+ * @return          1 iff the system call has been handled, 0 otherwise
+ */
+uint32_t swi_fast_dispatch(uint32_t num, uint32_t* args);
+
+/* END Fast system call functions */
+
+
 /* BEGIN System call management tables */
 
 extern uint32_t swi_types[];
 
 extern void* swi_functions[];
 
+extern uint32_t swi_fast_types[];
+
+extern void* swi_fast_functions[];
+
 /* END System call management tables */
 
 
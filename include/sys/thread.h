@@ -6,10 +6,13 @@
  */
 
 
+#include "config.h"
 #include "drivers/cp15.h"
 #include "drivers/util.h"
 #include "lib/inttypes.h"
 #include "lib/math.h"
+#include "lib/stats.h"
+#include "sys/kinfo.h"
 
 
 #ifndef THREAD_H_
@@ -39,8 +42,8 @@
 #define THREAD_CPSR_USER_MODE           0b00000000000000000000000000010000
 #define THREAD_CPSR_SYSTEM_MODE         0b00000000000000000000000000011111
 
-#define THREAD_MAX_THREADS              32
-#define THREAD_ROUND_ROBIN_TIME_SLOT    3
+#define THREAD_MAX_THREADS              CONFIG_MAX_THREADS
+#define THREAD_ROUND_ROBIN_TIME_SLOT    CONFIG_TIME_SLOT
 
 #define THREAD_INITIAL_PAGES            6
 
@@ -63,6 +66,12 @@
  * @field status            The thread's status
  * @field prio              The thread's priority
  * @field ttb               The thread's translation table base (physical address)
+ * @field run_time          The clock cycles the thread has been running
+ * @field ready_time        The clock cycles the thread has been ready but not running
+ * @field stamp             The clock value at which the thread has started running or become ready
+ * @field switches_vol      The number of times the thread has given up the processor itself
+ * @field switches_invol    The number of times the thread has been preempted
+ * @field wakeups           The number of times the thread has been woken up after blocking
  */
 struct thread_tcb {
     uint32_t id;
@@ -76,11 +85,20 @@ struct thread_tcb {
     uint8_t  status;
     uint16_t prio;
     uint32_t* ttb;
+    uint64_t run_time;
+    uint64_t ready_time;
+    uint64_t stamp;
+    uint32_t switches_vol;
+    uint32_t switches_invol;
+    uint32_t wakeups;
 };
 
 extern struct thread_tcb thread_tcb_list[THREAD_MAX_THREADS];
 extern uint8_t thread_switch_counter;
+extern uint8_t thread_switch_pending;
 extern uint32_t thread_sched_cur_idx;
+extern uint32_t* thread_cur_ctx;
+extern uint32_t* thread_cur_ttb;
 
 
 /* BEGIN Idle thread */
@@ -108,113 +126,42 @@ void thread_init_management(void);
 struct thread_tcb* thread_get_current(void);
 
 /**
- * Gets the fp of the last running thread.
- * Use only in the IRQ Interrupt Service Routine!
- * 
- * @return                  The fp as a pointer
- */
-__attribute__((always_inline))
-inline uint32_t* thread_get_fp(void) {
-    uint32_t* fp;
-    asm volatile (
-        "mov %[fp], fp \n\t"
-        : [fp] "=r" (fp)
-    );
-    return fp;
-}
-
-/**
- * Saves the context of the last running thread into its TCB.
- * Use only in the IRQ Interrupt Service Routine!
+ * Accounts the run time of the thread that has been running and the time the given thread has
+ * been waiting to run.
  * 
- * @param tcb               A pointer to the thread's TCB
+ * @param next              A pointer to the TCB of the thread that runs from now on
  */
-__attribute__((always_inline))
-inline void thread_save_context(struct thread_tcb* tcb) {
-
-    uint32_t* ptr;
-    uint8_t i;
-    uint32_t* b;
-    uint32_t s;
-
-    ptr = thread_get_fp() - 6;
-    for (i = 0; i < 4; i++) { // r0-r3
-        tcb->r[i] = ptr[i];
-    }
-
-    tcb->r[11] = ptr[4]; // fp r11
-    tcb->r[12] = ptr[5]; // ip r12
-    tcb->r[15] = ptr[6]; // pc r15
-
-    b = &tcb->r[4];
-    asm volatile ( // r4-r10
-        "stm %[rs], {r4-r10} \n\t"
-        : [rs] "=r" (b)
-    );
-
-    b = &tcb->r[13];
-    asm volatile ( // r13-r14
-        "stm %[rs], {r13-r14}^ \n\t"
-        : [rs] "=r" (b)
-    );
-
-    s = tcb->r[THREAD_REG_CPSR];
-    asm volatile ( // cpsr
-        "mrs %[rs], SPSR \n\t"
-        : [rs] "=r" (s)
-    );
-
-}
+void thread_account_switch(struct thread_tcb* next);
 
 /**
- * Returns the context of the last running thread from its TCB.
- * Use only in the IRQ Interrupt Service Routine!
+ * Makes a thread's context the one that the Interrupt Service Routines return to and switches to
+ * the thread's address space.
+ * Use only in exception handlers!
  * 
  * @param tcb               A pointer to the thread's TCB
  */
 __attribute__((always_inline))
 inline void thread_restore_context(struct thread_tcb* tcb) {
 
-    uint32_t* ptr;
-    uint8_t i;
-    uint32_t* b;
-    uint32_t s;
+    // Only switch the address space if it changes, e.g. not for task threads or when the thread
+    // keeps running after a system call
+    if (tcb->ttb != thread_cur_ttb) {
+        // Set the translation table base so the thread only sees its own address space
+        cp15_write_translation_table_base(tcb->ttb);
+        cp15_mmu_enable();
 
-    // Set the translation table base so the thread only sees its own address space
-    cp15_write_translation_table_base(tcb->ttb);
-    cp15_mmu_enable();
+        // Invalidate caches and TLB, apart from the kernel's locked down translations
+        cp15_invalidate_caches();
+        cp15_invalidate_tlb();
 
-    ptr = thread_get_fp() - 6;
-    for (i = 0; i < 4; i++) { // r0-r3
-        ptr[i] = tcb->r[i];
+        thread_cur_ttb = tcb->ttb;
     }
 
-    ptr[4] = tcb->r[11]; // fp r11
-    ptr[5] = tcb->r[12]; // ip r12
-    ptr[6] = tcb->r[15]; // pc r15
-
-    b = &tcb->r[4];
-    asm volatile ( // r4-r10
-        "ldm %[rs], {r4-r10} \n\t"
-        : [rs] "=r" (b)
-    );
-
-    b = &tcb->r[13];
-    asm volatile ( // r13-r14
-        "ldm %[rs], {r13-r14}^ \n\t"
-        : [rs] "=r" (b)
-    );
-
-    s = tcb->r[THREAD_REG_CPSR];
-
-    // Invalidate caches and TLB
-    cp15_invalidate_caches();
-    cp15_invalidate_tlb();
-
-    asm volatile ( // cpsr
-        "msr SPSR, %[rs] \n\t"
-        : [rs] "=r" (s)
-    );
+    if (thread_cur_ctx != tcb->r) {
+        thread_account_switch(tcb);
+        kinfo_switch(tcb->id);
+        thread_cur_ctx = tcb->r;
+    }
 
 }
 
@@ -230,6 +177,16 @@ inline void thread_restore_context(struct thread_tcb* tcb) {
  */
 struct thread_tcb* thread_create(void* text, uint32_t par_id, int8_t is_task, uint32_t is_idle);
 
+/**
+ * Creates a copy of a thread in a new address space that shares all pages with the thread's one.
+ * The copy continues where the thread is, writable pages are copied on the first write.
+ * 
+ * @param parent            A pointer to the TCB of the thread to copy
+ * 
+ * @return                  A pointer to the new thread's TCB, or 0 if there was an error
+ */
+struct thread_tcb* thread_fork(struct thread_tcb* parent);
+
 /**
  * Lets a thread destroy itself.
  * 
@@ -252,6 +209,16 @@ void thread_activate(uint32_t id);
  */
 void thread_deactivate(uint32_t id);
 
+/**
+ * Takes a snapshot of the statistics of all threads.
+ * 
+ * @param stats             Pointer to the array to write the snapshot into
+ * @param max               The number of entries in the array
+ * 
+ * @return                  The number of entries written
+ */
+uint32_t thread_get_stats(struct thread_stats* stats, uint32_t max);
+
 /* END Thread management functions */
 
 
@@ -273,7 +240,10 @@ inline void thread_select(void) {
 
     // Find out which is the next thread
     for (i = 1; i <= THREAD_MAX_THREADS; i++) {
-        j = math_mod(thread_sched_cur_idx + i, THREAD_MAX_THREADS);
+        j = thread_sched_cur_idx + i;
+        if (j >= THREAD_MAX_THREADS) {
+            j -= THREAD_MAX_THREADS;
+        }
         if (!j) {
             continue;
         }
@@ -289,29 +259,44 @@ inline void thread_select(void) {
 
 }
 
+/**
+ * Returns whether a thread other than the current one and the idle thread is ready to run.
+ * 
+ * @return                  1 iff there is another ready thread, 0 otherwise
+ */
+uint8_t thread_others_ready(void);
+
 /**
  * Switches the running thread.
  * 
- * Use only in the IRQ Interrupt Service Routine!
+ * Use only in exception handlers!
  */
 __attribute__((always_inline))
 inline void thread_switch(void) {
 
+    uint32_t prev_idx = thread_sched_cur_idx;
+    uint8_t preempted = 0;
+
     // Check that there is a thread currently running
     if (thread_tcb_list[thread_sched_cur_idx].status == THREAD_STATUS_RUNNING) {
-        // Do not switch if the thread has not worked through its time slot yet
-        if (thread_switch_counter++ < THREAD_ROUND_ROBIN_TIME_SLOT) {
+        // Do not switch if the thread has not worked through its time slot yet, the idle thread
+        // makes way immediately
+        if (thread_sched_cur_idx && thread_switch_counter++ < THREAD_ROUND_ROBIN_TIME_SLOT) {
             return;
         }
         thread_switch_counter = 0;
 
-        // Save the current thread's context and set its status
-        thread_save_context(&thread_tcb_list[thread_sched_cur_idx]);
+        // The context has already been saved on exception entry, only set the status
         thread_tcb_list[thread_sched_cur_idx].status = THREAD_STATUS_READY;
+        preempted = 1;
     }
 
     thread_select();
 
+    if (preempted && thread_sched_cur_idx != prev_idx) {
+        thread_tcb_list[prev_idx].switches_invol++;
+    }
+
     thread_restore_context(&thread_tcb_list[thread_sched_cur_idx]);
     thread_tcb_list[thread_sched_cur_idx].status = THREAD_STATUS_RUNNING;
 
@@ -322,6 +307,13 @@ inline void thread_switch(void) {
 
 /* BEGIN Functions to manage blocking reasons */
 
+/**
+ * Marks a blocked thread as ready again.
+ * 
+ * @param tcb               A pointer to the thread's TCB
+ */
+void thread_wake(struct thread_tcb* tcb);
+
 /**
  * Marks the current thread as blocked with the reason that it is waiting for input.
  */
@@ -348,6 +340,7 @@ struct thread_tcb* thread_unblock_for_char(void);
 
 /**
  * Marks a thread as unblocked with the reason that its timer has been interrupted.
+ * The remaining time is written in ms to r7.
  * 
  * @param tcb               A pointer to the thread to unblock
  */
@@ -356,13 +349,22 @@ void thread_unblock_for_timer_prematurely(struct thread_tcb* tcb);
 
 /**
  * Marks the current thread as blocked with the reason that it is waiting for a timer to finish.
+ * The time to sleep is given in ms in r7.
  */
 void thread_block_for_timer(struct thread_tcb* tcb);
 
 /**
  * Marks all threads as unblocked whose timers have finished.
+ * 
+ * @return                  The number of threads that have been unblocked
+ */
+uint8_t thread_unblock_for_timer(void);
+
+/**
+ * Sets the timer's alarm to the earliest deadline of all sleeping threads so they are woken up in
+ * between two ticks of the Period Interval Timer.
  */
-void thread_unblock_for_timer(void);
+void thread_update_timer_alarm(void);
 
 /* END Functions to manage blocking reasons */
 
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Functions for tracing kernel events into a ring buffer.
+ */
+
+
+#include "config.h"
+#include "drivers/util.h"
+#include "lib/inttypes.h"
+
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+
+// Whether the tracepoints record events, they and the ring buffer compile to nothing otherwise
+#define TRACE_ENABLED       CONFIG_TRACE
+
+// Number of records in the ring buffer, must be a power of two
+#define TRACE_SIZE          CONFIG_TRACE_SIZE
+
+// First word of a dump, "TRCE" in little endian
+#define TRACE_MAGIC         0x45435254
+
+// The character that dumps the ring buffer when it is received by the DBGU (Ctrl-T)
+#define TRACE_DUMP_KEY      0x14
+
+#define TRACE_SWITCH        0x01    // arg0: previous thread, arg1: next thread
+#define TRACE_IRQ           0x02    // arg0: handler address, arg1: nesting level
+#define TRACE_SWI           0x03    // arg0: system call number, arg1: return address
+#define TRACE_SWI_FAST      0x04    // arg0: system call number
+#define TRACE_WAKE          0x05    // arg0: woken thread
+#define TRACE_DEFER         0x06    // arg0: pending work items
+#define TRACE_PREFETCH_ABORT 0x07   // arg0: faulting address
+#define TRACE_DATA_ABORT    0x08    // arg0: accessed address, arg1: faulting address
+#define TRACE_PAGE_ALLOC    0x09    // arg0: page index
+#define TRACE_PAGE_FREE     0x0A    // arg0: page index
+#define TRACE_MAP           0x0B    // arg0: virtual address, arg1: page index
+#define TRACE_COW           0x0C    // arg0: written address, arg1: index of the now private page
+
+
+/**
+ * A trace record as it is stored in the ring buffer and dumped.
+ * 
+ * @field time      The lower 32 bits of the clock (see timer_read_clock())
+ * @field event     The event's ID
+ * @field tid       The ID of the thread that was running when the event occurred
+ * @field arg0      The first event-specific argument
+ * @field arg1      The second event-specific argument
+ */
+struct trace_record {
+    uint32_t time;
+    uint16_t event;
+    uint16_t tid;
+    uint32_t arg0;
+    uint32_t arg1;
+};
+
+/**
+ * The header that precedes the records of a dump.
+ * 
+ * @field magic     TRACE_MAGIC
+ * @field total     The number of records written since boot, i.e. records may have been lost if
+ *                  it is higher than `count`
+ * @field count     The number of records that follow, oldest first
+ * @field clock_hz  The frequency of the clock the timestamps are taken from
+ */
+struct trace_header {
+    uint32_t magic;
+    uint32_t total;
+    uint32_t count;
+    uint32_t clock_hz;
+};
+
+
+/**
+ * Records an event in the ring buffer.
+ * 
+ * @param event     The event's ID
+ * @param arg0      The first event-specific argument
+ * @param arg1      The second event-specific argument
+ */
+void trace_record(uint16_t event, uint32_t arg0, uint32_t arg1);
+
+/**
+ * Records a thread switch and attributes all following events to the next thread.
+ * 
+ * @param prev      The ID of the thread that has been running
+ * @param next      The ID of the thread that runs from now on
+ */
+void trace_record_switch(uint32_t prev, uint32_t next);
+
+/**
+ * Writes the ring buffer to the DBGU, bypassing the output buffer.
+ * The dump consists of a struct trace_header followed by the records, all in little endian. IRQs
+ * are disabled while it is written, so this stalls the system for some hundred ms.
+ * Writes nothing if tracing is disabled.
+ */
+void trace_dump(void);
+
+/**
+ * Records an event if tracing is enabled.
+ * 
+ * @param event     The event's ID
+ * @param arg0      The first event-specific argument
+ * @param arg1      The second event-specific argument
+ */
+__attribute__((always_inline))
+inline void trace(uint16_t event, uint32_t arg0, uint32_t arg1) {
+#if TRACE_ENABLED
+    trace_record(event, arg0, arg1);
+#else
+    UNUSED(event);
+    UNUSED(arg0);
+    UNUSED(arg1);
+#endif
+}
+
+/**
+ * Records a thread switch if tracing is enabled.
+ * 
+ * @param prev      The ID of the thread that has been running
+ * @param next      The ID of the thread that runs from now on
+ */
+__attribute__((always_inline))
+inline void trace_switch(uint32_t prev, uint32_t next) {
+#if TRACE_ENABLED
+    trace_record_switch(prev, next);
+#else
+    UNUSED(prev);
+    UNUSED(next);
+#endif
+}
+
+
+#endif /* TRACE_H_ */
@@ -21,7 +21,7 @@
 
 
 #include "lib/inttypes.h"
-#include "lib/mem.h"
+#include "lib/mman.h"
 #include "lib/stdio.h"
 #include "lib/stdlib.h"
 #include "sys/thread.h"
@@ -49,7 +49,7 @@ __attribute__((section(".lib")))
 void process(char c) {
     uint16_t local_counter = 0;
     uint16_t* global_counter;
-    if (!mmap(APP_ADDR)) {
+    if (mmap((void*) APP_ADDR, sizeof(uint16_t), PROT_READ | PROT_WRITE, MAP_FIXED) == MAP_FAILED) {
         printf("Error mmap");
     }
     global_counter = (uint16_t*) APP_ADDR;
@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * An application to benchmark the kernel's primitives.
+ * 
+ * The initial thread measures system call round trips, context switches between threads and
+ * between processes, the creation of processes (launched and forked) and task threads, the wake-up
+ * of sleeping threads, the mapping (and unmapping) of memory and the console throughput. All times
+ * are taken from the monotonic clock, each benchmark runs several times and the fastest run is
+ * reported.
+ * 
+ * The results are printed between `BENCH begin` and `BENCH end` as follows, all numbers are
+ * hexadecimal:
+ * 
+ * BENCH <name> <iterations> <total time in ns>
+ */
+
+
+#include "drivers/util.h"
+#include "lib/inttypes.h"
+#include "lib/mman.h"
+#include "lib/stats.h"
+#include "lib/stdio.h"
+#include "lib/stdlib.h"
+
+
+#define BENCH_RUNS          3
+#define BENCH_CALLS         10000
+#define BENCH_SWITCHES      2000
+#define BENCH_SPAWNS        100
+#define BENCH_SLEEPS        100
+#define BENCH_CONSOLE_BYTES 4096
+
+// Every task thread and fixed mapping keeps its section until its process exits, so these run in
+// a process of their own with only a few iterations
+#define BENCH_TASK_SPAWNS   8
+#define BENCH_MAPS          8
+#define BENCH_MAP_ADDR      0x30000000
+
+#define BENCH_MAX_THREADS   32
+#define BENCH_LINE_LENGTH   64
+
+#define NS_PER_MS           1000000
+
+
+typedef uint32_t (*bench_func)(uint32_t, uint32_t);
+
+
+/* BEGIN Helper functions */
+
+/**
+ * Returns the lower 32 bits of the monotonic time, enough for differences of up to four seconds.
+ * 
+ * @return          The time in ns
+ */
+__attribute__((section(".lib")))
+uint32_t bench_now(void) {
+    return (uint32_t) clock_gettime();
+}
+
+/**
+ * Prints a result.
+ * 
+ * @param name      The benchmark's name
+ * @param iter      The number of iterations
+ * @param ns        The total time of all iterations in ns
+ */
+__attribute__((section(".lib")))
+void bench_report(char* name, uint32_t iter, uint32_t ns) {
+    printf("BENCH %s %x %x\n", name, iter, ns);
+}
+
+/**
+ * Runs a benchmark several times and prints the fastest run.
+ * 
+ * @param name      The benchmark's name
+ * @param func      The benchmark, which gets the number of iterations and the run and returns the
+ *                  total time in ns
+ * @param iter      The number of iterations per run
+ * @param ops       The number of operations per iteration
+ */
+__attribute__((section(".lib")))
+void bench_run(char* name, bench_func func, uint32_t iter, uint32_t ops) {
+
+    uint32_t best = 0xFFFFFFFF;
+    uint32_t ns;
+    uint32_t run;
+
+    for (run = 0; run < BENCH_RUNS; run++) {
+        ns = func(iter, run);
+        if (ns < best) {
+            best = ns;
+        }
+    }
+
+    bench_report(name, iter * ops, best);
+
+}
+
+/**
+ * Waits until a thread has exited.
+ * 
+ * @param tid       The thread's ID
+ */
+__attribute__((section(".lib")))
+void bench_wait(uint32_t tid) {
+
+    struct thread_stats stats[BENCH_MAX_THREADS];
+    uint32_t num;
+    uint32_t i;
+
+    while (1) {
+        num = thread_stats(stats, BENCH_MAX_THREADS);
+        for (i = 0; i < num && stats[i].id != tid; i++);
+        if (i == num) {
+            return;
+        }
+        sleep(1);
+    }
+
+}
+
+/**
+ * A thread that yields a given number of times and exits.
+ * 
+ * @param iter      The number of times to yield
+ */
+__attribute__((section(".lib")))
+void bench_partner(uint32_t iter) {
+
+    while (iter--) {
+        yield();
+    }
+    exit(0);
+
+}
+
+/**
+ * A thread that exits immediately.
+ */
+__attribute__((section(".lib")))
+void bench_nop(void) {
+    exit(0);
+}
+
+/* END Helper functions */
+
+
+/* BEGIN Benchmarks */
+
+__attribute__((section(".lib")))
+uint32_t bench_gettid(uint32_t iter, uint32_t run) {
+
+    uint32_t start = bench_now();
+
+    UNUSED(run);
+    while (iter--) {
+        gettid();
+    }
+    return bench_now() - start;
+
+}
+
+__attribute__((section(".lib")))
+uint32_t bench_yield(uint32_t iter, uint32_t run) {
+
+    uint32_t start = bench_now();
+
+    UNUSED(run);
+    while (iter--) {
+        yield();
+    }
+    return bench_now() - start;
+
+}
+
+__attribute__((section(".lib")))
+uint32_t bench_write(uint32_t iter, uint32_t run) {
+
+    uint32_t start = bench_now();
+
+    UNUSED(run);
+    while (iter--) {
+        write_string(0, 0);
+    }
+    return bench_now() - start;
+
+}
+
+__attribute__((section(".lib")))
+uint32_t bench_switch_thread(uint32_t iter, uint32_t run) {
+
+    uint32_t start;
+    uint32_t ns;
+    uint32_t tid;
+
+    UNUSED(run);
+    tid = launch_task(&bench_partner, iter, 0);
+    start = bench_now();
+    while (iter--) {
+        yield();
+    }
+    ns = bench_now() - start;
+    bench_wait(tid);
+    return ns;
+
+}
+
+__attribute__((section(".lib")))
+uint32_t bench_switch_process(uint32_t iter, uint32_t run) {
+
+    uint32_t start;
+    uint32_t ns;
+    uint32_t tid;
+
+    UNUSED(run);
+    tid = launch(&bench_partner, iter, 0);
+    start = bench_now();
+    while (iter--) {
+        yield();
+    }
+    ns = bench_now() - start;
+    bench_wait(tid);
+    return ns;
+
+}
+
+__attribute__((section(".lib")))
+uint32_t bench_spawn_process(uint32_t iter, uint32_t run) {
+
+    uint32_t start = bench_now();
+
+    UNUSED(run);
+    while (iter--) {
+        // The child runs and exits as soon as we yield
+        launch(&bench_nop, 0, 0);
+        yield();
+    }
+    return bench_now() - start;
+
+}
+
+__attribute__((section(".lib")))
+uint32_t bench_fork(uint32_t iter, uint32_t run) {
+
+    uint32_t start = bench_now();
+
+    UNUSED(run);
+    while (iter--) {
+        if (!fork()) {
+            exit(0);
+        }
+        // Our first write to the stack copies it, the copy exits as soon as we yield
+        yield();
+    }
+    return bench_now() - start;
+
+}
+
+__attribute__((section(".lib")))
+uint32_t bench_spawn_task(uint32_t iter, uint32_t run) {
+
+    uint32_t start = bench_now();
+
+    UNUSED(run);
+    while (iter--) {
+        launch_task(&bench_nop, 0, 0);
+        yield();
+    }
+    return bench_now() - start;
+
+}
+
+__attribute__((section(".lib")))
+uint32_t bench_mmap(uint32_t iter, uint32_t run) {
+
+    uint32_t addr = BENCH_MAP_ADDR + run * iter * MB;
+    uint32_t start = bench_now();
+
+    while (iter--) {
+        mmap((void*) addr, MB, PROT_READ | PROT_WRITE, MAP_FIXED);
+        addr += MB;
+    }
+    return bench_now() - start;
+
+}
+
+__attribute__((section(".lib")))
+uint32_t bench_map_touch_unmap(uint32_t iter, uint32_t run) {
+
+    uint32_t* addr;
+    uint32_t start = bench_now();
+
+    UNUSED(run);
+    while (iter--) {
+        // The write maps and zeroes the page, unmapping returns it
+        addr = mmap(0, MB, PROT_READ | PROT_WRITE, 0);
+        *addr = iter;
+        munmap(addr, MB);
+    }
+    return bench_now() - start;
+
+}
+
+__attribute__((section(".lib")))
+void bench_memory(void) {
+    bench_run("spawn_task", &bench_spawn_task, BENCH_TASK_SPAWNS, 1);
+    bench_run("mmap", &bench_mmap, BENCH_MAPS, 1);
+    exit(0);
+}
+
+__attribute__((section(".lib")))
+void bench_sleep(void) {
+
+    uint32_t start;
+    uint32_t late;
+    uint32_t total = 0;
+    uint32_t max = 0;
+    uint32_t i;
+
+    for (i = 0; i < BENCH_SLEEPS; i++) {
+        start = bench_now();
+        sleep(1);
+        late = bench_now() - start - NS_PER_MS;
+        total += late;
+        if (late > max) {
+            max = late;
+        }
+    }
+
+    bench_report("sleep_1ms_late", BENCH_SLEEPS, total);
+    bench_report("sleep_1ms_late_max", 1, max);
+
+}
+
+__attribute__((section(".lib")))
+uint32_t bench_console(uint32_t iter, uint32_t run) {
+
+    char line[BENCH_LINE_LENGTH];
+    uint32_t start;
+    uint32_t left;
+    uint32_t i;
+
+    UNUSED(run);
+    for (i = 0; i < BENCH_LINE_LENGTH - 1; i++) {
+        line[i] = '.';
+    }
+    line[BENCH_LINE_LENGTH - 1] = '\n';
+
+    start = bench_now();
+    while (iter) {
+        // The output buffer only takes what fits, retry with the rest
+        left = BENCH_LINE_LENGTH;
+        while (left) {
+            left -= write_string(&line[BENCH_LINE_LENGTH - left], left);
+        }
+        iter -= BENCH_LINE_LENGTH;
+    }
+    return bench_now() - start;
+
+}
+
+/* END Benchmarks */
+
+
+__attribute__((section(".lib")))
+void main(void) {
+
+    printf("BENCH begin\n");
+
+    bench_run("gettid", &bench_gettid, BENCH_CALLS, 1);
+    bench_run("yield_fast", &bench_yield, BENCH_CALLS, 1);
+    bench_run("write_empty", &bench_write, BENCH_CALLS, 1);
+
+    // Every iteration switches away from and back to this thread
+    bench_run("switch_thread", &bench_switch_thread, BENCH_SWITCHES, 2);
+    bench_run("switch_process", &bench_switch_process, BENCH_SWITCHES, 2);
+
+    bench_run("spawn_process", &bench_spawn_process, BENCH_SPAWNS, 1);
+    bench_run("fork", &bench_fork, BENCH_SPAWNS, 1);
+    bench_run("map_touch_unmap", &bench_map_touch_unmap, BENCH_SPAWNS, 1);
+    bench_wait(launch(&bench_memory, 0, 0));
+
+    bench_sleep();
+
+    bench_run("console_write", &bench_console, BENCH_CONSOLE_BYTES, 1);
+
+    printf("BENCH end\n");
+    exit(0);
+
+}
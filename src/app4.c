@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * An application to demonstrate per-thread CPU accounting, similar to top.
+ * 
+ * The initial thread starts a few worker threads with different load patterns and then prints a
+ * table of all threads once per second. All numbers are hexadecimal.
+ * 
+ * The printed table is formatted as follows:
+ * 
+ * <ID> <status> <CPU share in per mille> <voluntary switches> <involuntary switches> <wakeups>
+ *      <time spent waiting for the processor in us>
+ */
+
+
+#include "lib/inttypes.h"
+#include "lib/math.h"
+#include "lib/stats.h"
+#include "lib/stdio.h"
+#include "lib/stdlib.h"
+
+
+#define TOP_INTERVAL    1000
+#define TOP_MAX_THREADS 32
+
+
+/**
+ * A worker that never gives up the processor.
+ */
+__attribute__((section(".lib")))
+void spin(void) {
+    while (1);
+}
+
+/**
+ * A worker that computes for a while and then sleeps.
+ * 
+ * @param ms        The time to sleep between two bursts
+ */
+__attribute__((section(".lib")))
+void burst(uint32_t ms) {
+
+    volatile uint32_t i;
+
+    while (1) {
+        for (i = 0; i < 100000; i++);
+        sleep(ms);
+    }
+
+}
+
+/**
+ * Returns the run time of a thread in a previous snapshot.
+ * 
+ * @param stats     The previous snapshot
+ * @param num       The number of entries in the snapshot
+ * @param id        The thread's ID
+ * 
+ * @return          The thread's run time, or 0 if it is not in the snapshot
+ */
+__attribute__((section(".lib")))
+uint64_t prev_run_time(struct thread_stats* stats, uint32_t num, uint32_t id) {
+
+    uint32_t i;
+
+    for (i = 0; i < num; i++) {
+        if (stats[i].id == id) {
+            return stats[i].run_time;
+        }
+    }
+    return 0;
+
+}
+
+__attribute__((section(".lib")))
+void main(void) {
+
+    struct thread_stats buffers[2][TOP_MAX_THREADS];
+    struct thread_stats* cur = buffers[0];
+    struct thread_stats* prev = buffers[1];
+    struct thread_stats* tmp;
+    uint32_t num_cur;
+    uint32_t num_prev = 0;
+    uint64_t time_cur;
+    uint64_t time_prev = clock_gettime();
+    uint32_t interval;
+    uint32_t share;
+    uint32_t i;
+
+    launch(&spin, 0, 0);
+    launch(&burst, 10, 0);
+    launch(&burst, 100, 0);
+
+    while (1) {
+        sleep(TOP_INTERVAL);
+
+        num_cur = thread_stats(cur, TOP_MAX_THREADS);
+        time_cur = clock_gettime();
+
+        // Work in units of 1024 ns so the products below fit into 32 bits
+        interval = (uint32_t) ((time_cur - time_prev) >> 10);
+
+        printf("ID       STATUS   CPU      VOL      INVOL    WAKEUPS  WAIT\n");
+        for (i = 0; i < num_cur; i++) {
+            share = (uint32_t) ((cur[i].run_time - prev_run_time(prev, num_prev, cur[i].id)) >> 10);
+            share = math_div(share * 1000, interval);
+
+            printf("%x %x %x %x %x %x %x\n", cur[i].id, cur[i].status, share,
+                    cur[i].switches_vol, cur[i].switches_invol, cur[i].wakeups,
+                    (uint32_t) (cur[i].ready_time >> 10));
+        }
+        printf("\n");
+
+        tmp = prev;
+        prev = cur;
+        cur = tmp;
+        num_prev = num_cur;
+        time_prev = time_cur;
+    }
+
+}
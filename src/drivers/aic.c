@@ -282,21 +282,86 @@
 
 /* BEGIN Functions to interact with the hardware directly */
 
-void aic_enable_system_peripherals(void) {
-    write_u32(AIC_BASE, AIC_SMR1, AIC_SRCTYPE_00 | AIC_PRIOR_7);
-    write_u32(AIC_BASE, AIC_IECR, AIC_SYS);
-}
-
 void aic_clear_system_peripherals(void) {
     write_u32(AIC_BASE, AIC_ICCR, AIC_SYS);
 }
 
-void aic_read_ivr(void) {
-    read_u32(AIC_BASE, AIC_IVR);
+__attribute__((section(".iram")))
+uint32_t aic_read_ivr(void) {
+    return read_u32(AIC_BASE, AIC_IVR);
 }
 
+__attribute__((section(".iram")))
 void aic_end_of_interrupt(void) {
     write_u32(AIC_BASE, AIC_EOICR, 0x01);
 }
 
 /* END Functions to interact with the hardware directly */
+
+
+/* BEGIN Functions abstracting direct hardware access */
+
+/**
+ * Initializes the AIC, i.e. disables and clears all sources and sets the spurious interrupt vector.
+ * 
+ * @param spurious  The handler returned by the AIC when there is no interrupt to serve
+ */
+void aic_init(void (*spurious)(void)) {
+
+    uint8_t i;
+
+    write_u32(AIC_BASE, AIC_IDCR, 0xFFFFFFFF);
+    write_u32(AIC_BASE, AIC_ICCR, 0xFFFFFFFF);
+
+    // Unwind the priority stack in case anything has been left in service before
+    for (i = 0; i < 8; i++) {
+        aic_end_of_interrupt();
+    }
+
+    write_u32(AIC_BASE, AIC_SPU, (uint32_t) spurious);
+
+}
+
+/**
+ * Registers a handler for an interrupt source and enables the source.
+ * The handler is programmed into the source's vector register and returned by aic_read_ivr()
+ * whenever this source is the pending source with the highest priority.
+ * 
+ * @param source    The interrupt source (peripheral ID)
+ * @param prio      The priority level, from AIC_PRIO_LOWEST to AIC_PRIO_HIGHEST
+ * @param trigger   AIC_TRIGGER_LEVEL or AIC_TRIGGER_EDGE
+ * @param handler   The handler for the source
+ */
+void aic_register(uint8_t source, uint8_t prio, uint8_t trigger, void (*handler)(void)) {
+
+    uint32_t smr = (prio & AIC_PRIOR_7) | (trigger ? AIC_SRCTYPE_01 : AIC_SRCTYPE_00);
+
+    if (source >= AIC_SOURCES) {
+        return;
+    }
+
+    write_u32(AIC_BASE, AIC_IDCR, 1 << source);
+    write_u32(AIC_BASE, AIC_SMR0 + 4 * source, smr);
+    write_u32(AIC_BASE, AIC_SVR0 + 4 * source, (uint32_t) handler);
+    write_u32(AIC_BASE, AIC_ICCR, 1 << source);
+    write_u32(AIC_BASE, AIC_IECR, 1 << source);
+
+}
+
+/**
+ * Disables an interrupt source and removes its handler.
+ * 
+ * @param source    The interrupt source (peripheral ID)
+ */
+void aic_unregister(uint8_t source) {
+
+    if (source >= AIC_SOURCES) {
+        return;
+    }
+
+    write_u32(AIC_BASE, AIC_IDCR, 1 << source);
+    write_u32(AIC_BASE, AIC_SVR0 + 4 * source, read_u32(AIC_BASE, AIC_SPU));
+
+}
+
+/* END Functions abstracting direct hardware access */
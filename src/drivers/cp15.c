@@ -18,6 +18,7 @@
 /**
  * Enables the MMU.
  */
+__attribute__((section(".iram")))
 void cp15_mmu_enable(void) {
 
     asm volatile (
@@ -67,9 +68,10 @@ void cp15_init_domains(void) {
      */
 
     // Currently we are not interested in a case where we wouldn't want to check accesses
-    // against the access permission, so we define one single domain where this is the case.
+    // against the access permission, so both domains we use are clients. Domain 0 holds all
+    // regular mappings, domain 1 marks the copy-on-write sections (see memmgmt).
     asm volatile (
-        "mov r1, #1 \n"
+        "mov r1, #5 \n"
         "mcr p15, 0, r1, c3, c0, 0 \n"
         : : : "r1"
     );
@@ -81,6 +83,7 @@ void cp15_init_domains(void) {
  * 
  * @param ptr       The address of the TTB
  */
+__attribute__((section(".iram")))
 void cp15_write_translation_table_base(uint32_t* ptr) {
 
     ptr = (uint32_t*) ((uint32_t)ptr & 0xFFFFC000);
@@ -94,6 +97,26 @@ void cp15_write_translation_table_base(uint32_t* ptr) {
 
 }
 
+/**
+ * Reads the address of the translation table base from the MMU.
+ * 
+ * @return          The address of the TTB
+ */
+__attribute__((section(".iram")))
+uint32_t* cp15_read_translation_table_base(void) {
+
+    uint32_t ret;
+    asm volatile (
+        "mrc p15, 0, r7, c2, c0, 0 \n"
+        "mov %[ret], r7"
+        : [ret] "=r" (ret)
+        :
+        : "r7"
+    );
+    return (uint32_t*) (ret & 0xFFFFC000);
+
+}
+
 /* END Functions for MMU, domain access and TTB management */
 
 
@@ -182,6 +205,7 @@ void cp15_invalidate_icache(void) {
 /**
  * Invalidates both caches.
  */
+__attribute__((section(".iram")))
 void cp15_invalidate_caches(void) {
 
     asm volatile (
@@ -191,6 +215,132 @@ void cp15_invalidate_caches(void) {
 
 }
 
+/**
+ * Cleans the data cache line that holds a given virtual address, i.e. writes it back to memory.
+ * 
+ * @param address   The virtual address
+ */
+void cp15_clean_dcache_entry(uint32_t address) {
+
+    asm volatile (
+        "mov r7, %[address] \n"
+        "mcr p15, 0, r7, c7, c10, 1 \n"
+        :
+        : [address] "r" (address)
+        : "r7"
+    );
+
+}
+
+/**
+ * Invalidates the data cache line that holds a given virtual address without writing it back.
+ * 
+ * @param address   The virtual address
+ */
+void cp15_invalidate_dcache_entry(uint32_t address) {
+
+    asm volatile (
+        "mov r7, %[address] \n"
+        "mcr p15, 0, r7, c7, c6, 1 \n"
+        :
+        : [address] "r" (address)
+        : "r7"
+    );
+
+}
+
+/**
+ * Cleans and invalidates the data cache line that holds a given virtual address.
+ * 
+ * @param address   The virtual address
+ */
+void cp15_clean_invalidate_dcache_entry(uint32_t address) {
+
+    asm volatile (
+        "mov r7, %[address] \n"
+        "mcr p15, 0, r7, c7, c14, 1 \n"
+        :
+        : [address] "r" (address)
+        : "r7"
+    );
+
+}
+
+/**
+ * Invalidates the instruction cache line that holds a given virtual address.
+ * 
+ * @param address   The virtual address
+ */
+void cp15_invalidate_icache_entry(uint32_t address) {
+
+    asm volatile (
+        "mov r7, %[address] \n"
+        "mcr p15, 0, r7, c7, c5, 1 \n"
+        :
+        : [address] "r" (address)
+        : "r7"
+    );
+
+}
+
+/**
+ * Cleans and invalidates the whole data cache by walking all of its segments and indices.
+ */
+void cp15_clean_invalidate_dcache(void) {
+
+    uint32_t segment;
+    uint32_t index;
+
+    for (segment = 0; segment < CP15_DCACHE_SEGMENTS; segment++) {
+        for (index = 0; index < CP15_DCACHE_INDICES; index++) {
+            asm volatile (
+                "mov r7, %[line] \n"
+                "mcr p15, 0, r7, c7, c14, 2 \n"
+                :
+                : [line] "r" (index << 26 | segment << 5)
+                : "r7"
+            );
+        }
+    }
+    cp15_drain_write_buffer();
+
+}
+
+/**
+ * Cleans and invalidates the data cache lines that hold a range of virtual addresses. Ranges of at
+ * least the cache's size are handled by cleaning the whole cache, which takes fewer operations.
+ * 
+ * @param address   The first address of the range
+ * @param size      The size of the range in bytes
+ */
+void cp15_clean_invalidate_dcache_range(uint32_t address, uint32_t size) {
+
+    uint32_t end = address + size;
+
+    if (size >= CP15_DCACHE_SIZE) {
+        cp15_clean_invalidate_dcache();
+        return;
+    }
+
+    for (address &= ~(CP15_CACHE_LINE_SIZE - 1); address < end; address += CP15_CACHE_LINE_SIZE) {
+        cp15_clean_invalidate_dcache_entry(address);
+    }
+    cp15_drain_write_buffer();
+
+}
+
+/**
+ * Waits until the write buffer has written all pending stores to memory.
+ */
+void cp15_drain_write_buffer(void) {
+
+    asm volatile (
+        "mcr p15, 0, r12, c7, c10, 4 \n"
+        : : :
+    );
+
+}
+
 /* END Functions for cache management */
 
 
@@ -223,6 +373,7 @@ void cp15_invalidate_itlb(void) {
 /**
  * Invalidates both Translation Lookaside Buffers.
  */
+__attribute__((section(".iram")))
 void cp15_invalidate_tlb(void) {
 
     asm volatile (
@@ -232,6 +383,153 @@ void cp15_invalidate_tlb(void) {
 
 }
 
+/**
+ * Invalidates the data Translation Lookaside Buffer's entry for a given virtual address.
+ * 
+ * @param address   The virtual address
+ */
+void cp15_invalidate_dtlb_entry(uint32_t address) {
+
+    asm volatile (
+        "mov r7, %[address] \n"
+        "mcr p15, 0, r7, c8, c6, 1 \n"
+        :
+        : [address] "r" (address)
+        : "r7"
+    );
+
+}
+
+/**
+ * Invalidates the instruction Translation Lookaside Buffer's entry for a given virtual address.
+ * 
+ * @param address   The virtual address
+ */
+void cp15_invalidate_itlb_entry(uint32_t address) {
+
+    asm volatile (
+        "mov r7, %[address] \n"
+        "mcr p15, 0, r7, c8, c5, 1 \n"
+        :
+        : [address] "r" (address)
+        : "r7"
+    );
+
+}
+
+/**
+ * Invalidates the entries for a given virtual address in both Translation Lookaside Buffers.
+ * 
+ * @param address   The virtual address
+ */
+__attribute__((section(".iram")))
+void cp15_invalidate_tlb_entry(uint32_t address) {
+
+    asm volatile (
+        "mov r7, %[address] \n"
+        "mcr p15, 0, r7, c8, c5, 1 \n"
+        "mcr p15, 0, r7, c8, c6, 1 \n"
+        :
+        : [address] "r" (address)
+        : "r7"
+    );
+
+}
+
+/**
+ * Loads the translation of a virtual address into the data TLB and locks the entry down, i.e. it
+ * survives invalidations of the whole TLB and is never chosen as a victim again.
+ * The MMU has to be enabled and the address must be readable without side effects.
+ * One entry is always left unlocked for the translations that are not locked down.
+ * 
+ * @param address   The virtual address
+ * 
+ * @return          1 iff the entry is locked down, 0 if there is no entry left to lock
+ */
+uint8_t cp15_lock_dtlb_entry(uint32_t address) {
+
+    uint32_t base;
+    asm volatile (
+        "mrc p15, 0, r7, c10, c0, 0 \n"
+        "mov %[base], r7, lsr #26 \n"       // the entries below the base are locked down
+        : [base] "=r" (base)
+        :
+        : "r7"
+    );
+
+    if (base >= CP15_TLB_ENTRIES - 1) {
+        return 0;
+    }
+
+    // Load the entry at base with the preserve bit set, then move base and victim past it
+    asm volatile (
+        "mov r7, %[address] \n"
+        "mcr p15, 0, r7, c8, c6, 1 \n"      // make sure the table walk happens
+        "mov r8, %[base], lsl #26 \n"
+        "orr r8, r8, %[base], lsl #20 \n"   // victim = base
+        "orr r8, r8, #1 \n"                 // preserve the next loaded entry
+        "mcr p15, 0, r8, c10, c0, 0 \n"
+        "ldr r7, [r7] \n"
+        "add r8, %[base], #1 \n"
+        "mov r7, r8, lsl #26 \n"
+        "orr r7, r7, r8, lsl #20 \n"        // base = victim = base + 1, preserve bit clear
+        "mcr p15, 0, r7, c10, c0, 0 \n"
+        :
+        : [address] "r" (address), [base] "r" (base)
+        : "r7", "r8", "memory"
+    );
+
+    return 1;
+
+}
+
+/**
+ * Loads the translation of a virtual address into the instruction TLB and locks the entry down,
+ * i.e. it survives invalidations of the whole TLB and is never chosen as a victim again.
+ * The MMU has to be enabled.
+ * One entry is always left unlocked for the translations that are not locked down.
+ * 
+ * @param address   The virtual address
+ * 
+ * @return          1 iff the entry is locked down, 0 if there is no entry left to lock
+ */
+uint8_t cp15_lock_itlb_entry(uint32_t address) {
+
+    uint32_t base;
+    asm volatile (
+        "mrc p15, 0, r7, c10, c0, 1 \n"
+        "mov %[base], r7, lsr #26 \n"       // the entries below the base are locked down
+        : [base] "=r" (base)
+        :
+        : "r7"
+    );
+
+    if (base >= CP15_TLB_ENTRIES - 1) {
+        return 0;
+    }
+
+    // Load the entry at base with the preserve bit set, then move base and victim past it
+    asm volatile (
+        "mov r7, %[address] \n"
+        "mcr p15, 0, r7, c8, c5, 1 \n"      // make sure the table walk happens
+        "mov r8, %[base], lsl #26 \n"
+        "orr r8, r8, %[base], lsl #20 \n"   // victim = base
+        "orr r8, r8, #1 \n"                 // preserve the next loaded entry
+        "mcr p15, 0, r8, c10, c0, 1 \n"
+        "mcr p15, 0, r7, c7, c13, 1 \n"     // prefetching the line loads the entry at the victim
+        "add r8, %[base], #1 \n"
+        "mov r7, r8, lsl #26 \n"
+        "orr r7, r7, r8, lsl #20 \n"        // base = victim = base + 1, preserve bit clear
+        "mcr p15, 0, r7, c10, c0, 1 \n"
+        :
+        : [address] "r" (address), [base] "r" (base)
+        : "r7", "r8"
+    );
+
+    return 1;
+
+}
+
 /* END Functions for TLB management */
 
 
@@ -254,4 +552,23 @@ uint32_t cp15_read_fault_address(void) {
 
 }
 
+/**
+ * Returns the Fault Status Register of the last data abort, i.e. the fault type in bits 3:0 and
+ * the domain of the accessed section in bits 7:4.
+ */
+__attribute__((section(".iram")))
+uint32_t cp15_read_fault_status(void) {
+
+    uint32_t ret;
+    asm volatile (
+        "mrc p15, 0, r7, c5, c0, 0 \n"
+        "mov %[ret], r7"
+        : [ret] "=r" (ret)
+        :
+        : "r7"
+    );
+    return ret;
+
+}
+
 /* END Functions for fault management */
@@ -264,18 +264,22 @@ void dbgu_reset(void) {
     write_u32(DBGUB, DBGU_CR, DBGU_RSTRX|DBGU_RSTTX);
 }
 
+__attribute__((section(".iram")))
 void dbgu_rxrdy_interrupt_enable(void) {
     write_u32(DBGUB, DBGU_IER, DBGU_RXRDY);
 }
 
+__attribute__((section(".iram")))
 void dbgu_rxrdy_interrupt_disable(void) {
     write_u32(DBGUB, DBGU_IDR, DBGU_RXRDY);
 }
 
+__attribute__((section(".iram")))
 void dbgu_txrdy_interrupt_enable(void) {
     write_u32(DBGUB, DBGU_IER, DBGU_TXRDY);
 }
 
+__attribute__((section(".iram")))
 void dbgu_txrdy_interrupt_disable(void) {
     write_u32(DBGUB, DBGU_IDR, DBGU_TXRDY);
 }
@@ -300,6 +304,22 @@ void dbgu_write_string(char* string) {
 
 }
 
+/**
+ * Writes a buffer into the DBGU by writing single bytes into the Transmit Holding Register until
+ * all bytes have been sent.
+ * 
+ * @param bytes     A pointer to the buffer
+ * @param size      The size of the buffer
+ */
+void dbgu_write_bytes(uint8_t* bytes, size_t size) {
+
+    while (size--) {
+        while (!(read_u8(DBGUB, DBGU_SR) & DBGU_TXRDY));
+        write_u8(DBGUB, DBGU_THR, *(bytes++));
+    }
+
+}
+
 /**
  * Reads a single character from the DBGU that is being held in the Receive Holding Register.
  * This function uses polling to determine whether there is a character to be read.
@@ -318,6 +338,7 @@ char dbgu_read_char_poll(void) {
  * 
  * @return          The character that has been read
  */
+__attribute__((section(".iram")))
 char dbgu_read_char(void) {
     return read_u8(DBGUB, DBGU_RHR);
 }
@@ -327,6 +348,7 @@ char dbgu_read_char(void) {
  * 
  * @param c         The character to be written
  */
+__attribute__((section(".iram")))
 void dbgu_write_char(char c) {
     write_u8(DBGUB, DBGU_THR, c);
 }
@@ -339,6 +361,7 @@ void dbgu_write_char(char c) {
  *                  1 = At least one complete character has been received,
  *                      transferred to DBGU_RHR and not yet read.
  */
+__attribute__((section(".iram")))
 uint8_t dbgu_char_readable(void) {
     return read_u8(DBGUB, DBGU_SR) & DBGU_RXRDY;
 }
@@ -352,6 +375,7 @@ uint8_t dbgu_char_readable(void) {
  *                  1 = There is no character written to DBGU_THR and not yet
  *                      transferred to the Shift Register.
  */
+__attribute__((section(".iram")))
 uint8_t dbgu_char_writable(void) {
     return read_u8(DBGUB, DBGU_SR) & DBGU_TXRDY;
 }
@@ -13,13 +13,51 @@
 #include "drivers/mc.h"
 #include "drivers/timer.h"
 #include "lib/inttypes.h"
+#include "sys/defer.h"
 #include "sys/io.h"
+#include "sys/kinfo.h"
+#include "sys/latency.h"
+#include "sys/memmgmt.h"
+#include "sys/profile.h"
 #include "sys/swi.h"
 #include "sys/sysio.h"
 #include "sys/thread.h"
+#include "sys/trace.h"
 
 
 typedef void (*func)(struct thread_tcb*);
+typedef void (*handler)(void);
+
+
+// Saves all user mode registers into the current context with a single STM, followed by the return
+// address in LR and the SPSR (offsets of r[THREAD_REG_PC] and r[THREAD_REG_CPSR])
+#define INTERRUPT_SAVE_CONTEXT \
+        "str lr, [sp, #-4]! \n\t" \
+        "ldr lr, =thread_cur_ctx \n\t" \
+        "ldr lr, [lr] \n\t" \
+        "stmia lr, {r0-r14}^ \n\t" \
+        "nop \n\t" \
+        "ldr r0, [sp], #4 \n\t" \
+        "str r0, [lr, #60] \n\t" \
+        "mrs r0, SPSR \n\t" \
+        "str r0, [lr, #64] \n\t"
+
+// Restores the current context, which may have been changed by a thread switch, and returns to it
+#define INTERRUPT_RESTORE_CONTEXT \
+        "ldr lr, =thread_cur_ctx \n\t" \
+        "ldr lr, [lr] \n\t" \
+        "ldr r0, [lr, #64] \n\t" \
+        "msr SPSR_cxsf, r0 \n\t" \
+        "ldmia lr, {r0-r14}^ \n\t" \
+        "nop \n\t" \
+        "ldr lr, [lr, #60] \n\t" \
+        "movs pc, lr \n\t"
+
+
+uint8_t interrupt_nesting;
+
+// Set by the System Peripherals handler when the Period Interval Timer has ticked
+uint8_t interrupt_pit_tick;
 
 
 /**
@@ -55,6 +93,7 @@ void isr_reset(void) {
  * Undefined instruction
  */
 __attribute__ ((interrupt ("UNDEF")))
+__attribute__((section(".iram")))
 void isr_undefined(void) {
     void* iptr = read_link_register() - 4;
     uint32_t inst = *(uint32_t*)iptr;
@@ -64,25 +103,178 @@ void isr_undefined(void) {
 
 /**
  * Software Interrupt (SWI)
+ * System calls that neither block nor switch threads are handled on a fast path that only saves the
+ * registers clobbered by a function call, the others save the thread's full context.
  */
-__attribute__ ((interrupt ("SWI")))
+__attribute__ ((naked))
+__attribute__((section(".iram")))
 void isr_software_interrupt(void) {
 
+    asm volatile (
+        "stmfd sp!, {r0-r3, r7, r8, r12, lr} \n\t"
+        "ldr r0, [lr, #-4] \n\t"
+        "and r0, r0, #0xFF \n\t"             // the system call number
+        "add r1, sp, #16 \n\t"               // the saved r7 and r8 hold the parameters
+        "bl swi_fast_dispatch \n\t"
+        "cmp r0, #0 \n\t"
+        "ldmnefd sp!, {r0-r3, r7, r8, r12, pc}^ \n\t"
+        "ldmfd sp!, {r0-r3, r7, r8, r12, lr} \n\t"
+
+        INTERRUPT_SAVE_CONTEXT
+        "bl interrupt_handle_swi \n\t"
+        INTERRUPT_RESTORE_CONTEXT
+        ".ltorg \n\t"
+    );
+
+}
+
+/**
+ * Prefetch Abort
+ */
+__attribute__ ((naked))
+__attribute__((section(".iram")))
+void isr_prefetch_abort(void) {
+
+    asm volatile (
+        "sub lr, lr, #4 \n\t"                 // the aborted instruction
+        INTERRUPT_SAVE_CONTEXT
+        "bl interrupt_handle_prefetch_abort \n\t"
+        INTERRUPT_RESTORE_CONTEXT
+        ".ltorg \n\t"
+    );
+
+}
+
+/**
+ * Data Abort
+ * Only an abort in user mode belongs to the current thread's context, an abort in a privileged mode
+ * is handled on the abort stack and returns straight to the aborted kernel code, unless it
+ * terminated the thread of a system call.
+ */
+__attribute__ ((naked))
+__attribute__((section(".iram")))
+void isr_data_abort(void) {
+
+    asm volatile (
+        "sub lr, lr, #8 \n\t"                 // the aborted instruction
+        "stmfd sp!, {r0-r3, r12, lr} \n\t"
+        "mrs r1, SPSR \n\t"
+        "and r0, r1, #0x1F \n\t"             // INTERRUPT_MODE_MASK
+        "cmp r0, #0x10 \n\t"                 // INTERRUPT_MODE_USER
+        "bne 1f \n\t"
+        "ldmfd sp!, {r0-r3, r12, lr} \n\t"
+
+        INTERRUPT_SAVE_CONTEXT
+        "bl interrupt_handle_data_abort \n\t"
+        INTERRUPT_RESTORE_CONTEXT
+
+        "1: \n\t"
+        "mov r0, lr \n\t"
+        "bl interrupt_handle_kernel_data_abort \n\t"
+        "cmp r0, #0 \n\t"
+        "ldmeqfd sp!, {r0-r3, r12, pc}^ \n\t"
+
+        // The thread of the aborted system call is gone, drop the system call's frames and continue
+        // with the next thread
+        "add sp, sp, #24 \n\t"
+        "mrs r0, CPSR \n\t"
+        "bic r1, r0, #0x1F \n\t"           // INTERRUPT_MODE_MASK
+        "orr r1, r1, #0x13 \n\t"           // INTERRUPT_MODE_SVC
+        "msr CPSR_c, r1 \n\t"
+        "ldr sp, =0x00204800 \n\t"         // INTERRUPT_SVC_STACK
+        "msr CPSR_c, r0 \n\t"
+        INTERRUPT_RESTORE_CONTEXT
+        ".ltorg \n\t"
+    );
+
+}
+
+/**
+ * Fast Interrupt Request (FIQ)
+ * The Fast Interrupt Input is not routed to any device, so this is never expected to run.
+ */
+__attribute__ ((interrupt ("FIQ")))
+__attribute__((section(".iram")))
+void isr_fast_interrupt_request(void) {
     void* iptr = read_link_register() - 4;
+
+    printf_isr("Fast Interrupt request detected during execution at address 0x%p.\n", iptr);
+}
+
+/**
+ * Interrupt Request (IRQ)
+ * If the IRQ has interrupted a thread or the boot code, its context is saved into the current
+ * context, which the handler may change by switching threads. If it has interrupted another IRQ
+ * handler or deferred work, only the registers clobbered by the handler are saved on the stack.
+ */
+__attribute__ ((naked))
+__attribute__((section(".iram")))
+void isr_interrupt_request(void) {
+
+    asm volatile (
+        "sub lr, lr, #4 \n\t"                 // the interrupted instruction
+        "str r0, [sp, #-4]! \n\t"
+        "ldr r0, =interrupt_nesting \n\t"
+        "ldrb r0, [r0] \n\t"
+        "cmp r0, #0 \n\t"
+        "ldr r0, [sp], #4 \n\t"
+        "bne 1f \n\t"
+
+        INTERRUPT_SAVE_CONTEXT
+        "mov r1, r0 \n\t"                   // the interrupted PSR
+        "ldr r0, [lr, #60] \n\t"            // the interrupted instruction
+        "bl interrupt_handle_irq \n\t"
+        INTERRUPT_RESTORE_CONTEXT
+
+        "1: \n\t"
+        "stmfd sp!, {r0-r3, r12, lr} \n\t"
+        "mrs r0, SPSR \n\t"
+        "str r0, [sp, #-8]! \n\t"
+        "mov r1, r0 \n\t"
+        "mov r0, lr \n\t"
+        "bl interrupt_handle_irq \n\t"
+        "ldr r0, [sp], #8 \n\t"
+        "msr SPSR_cxsf, r0 \n\t"
+        "ldmfd sp!, {r0-r3, r12, pc}^ \n\t"
+        ".ltorg \n\t"
+    );
+
+}
+
+/* END Interrupt Service Routines */
+
+
+/* BEGIN Exception handlers called by the Interrupt Service Routines */
+
+/**
+ * Handler for Software Interrupts, dispatches the system call.
+ */
+__attribute__((section(".iram")))
+void interrupt_handle_swi(void) {
+
+    struct thread_tcb* caller = thread_get_current();
+    struct thread_tcb* tcb = caller;
+    void* iptr = (void*) (tcb->r[THREAD_REG_PC] - 4);
     uint32_t inst = *(uint32_t*)iptr & 0xFF;
     uint8_t i = 0;
 
-    struct thread_tcb* tcb = thread_get_current();
-    thread_save_context(tcb);
+    trace(TRACE_SWI, inst, (uint32_t) iptr);
 
     while (swi_types[i++]) {
         if (inst == swi_types[i-1]) {
+            // System calls run with IRQs disabled from start to end
+            latency_irqs_off(swi_functions[i-1]);
             ((func)swi_functions[i-1])(tcb);
 
+            // The caller has blocked, yielded or exited
             tcb = thread_get_current();
+            if (tcb != caller) {
+                caller->switches_vol++;
+            }
             tcb->status = THREAD_STATUS_RUNNING;
             thread_restore_context(tcb);
 
+            latency_irqs_on();
             return;
         }
     }
@@ -92,85 +284,214 @@ void isr_software_interrupt(void) {
 }
 
 /**
- * Prefetch Abort
+ * Handler for Prefetch Aborts, destroys the thread that caused it.
  */
-__attribute__ ((interrupt ("ABORT")))
-void isr_prefetch_abort(void) {
-    void* iptr = read_link_register() - 4;
+__attribute__((section(".iram")))
+void interrupt_handle_prefetch_abort(void) {
+
+    struct thread_tcb* tcb = thread_get_current();
+
+    trace(TRACE_PREFETCH_ABORT, tcb->r[THREAD_REG_PC], 0);
+    latency_irqs_off(&interrupt_handle_prefetch_abort);
+
+    printf_isr("Prefetch abort by thread %x detected at address 0x%p.\n",
+            tcb->id, (void*) tcb->r[THREAD_REG_PC]);
+    thread_print_info(tcb);
+
+    thread_exit(tcb, THREAD_DESTROY_CODE);
+    thread_switch();
+
+    latency_irqs_on();
 
-    printf_isr("Prefetch abort detected at address 0x%p.\n", iptr);
 }
 
 /**
- * Data Abort
+ * Handler for Data Aborts, maps reserved sections on their first access, resolves writes to
+ * copy-on-write sections and destroys the thread that caused any other abort.
  */
-__attribute__ ((interrupt ("ABORT")))
-void isr_data_abort(void) {
-    void* iptr = read_link_register() - 8;
-    void* addr = (void*) cp15_read_fault_address(); // TODO distinguish abort sources
+__attribute__((section(".iram")))
+void interrupt_handle_data_abort(void) {
+
+    void* addr = (void*) cp15_read_fault_address();
+    uint32_t status = cp15_read_fault_status();
     struct thread_tcb* tcb = thread_get_current();
 
-    thread_save_context(tcb);
+    latency_irqs_off(&interrupt_handle_data_abort);
+
+    // The thread retries the access once the reserved section is mapped or it has its own copy of
+    // the section
+    if (((status & CP15_FSR_TYPE) == CP15_FSR_TRANSLATION_SECTION
+                && memmgmt_resolve_reserved(tcb->ttb, (uint32_t) addr))
+            || ((status & CP15_FSR_TYPE) == CP15_FSR_PERMISSION_SECTION
+                && memmgmt_resolve_cow(tcb->ttb, (uint32_t) addr))) {
+        latency_irqs_on();
+        return;
+    }
+
+    trace(TRACE_DATA_ABORT, (uint32_t) addr, tcb->r[THREAD_REG_PC]);
 
     printf_isr("Data abort by thread %x for attempted access of 0x%p detected at address 0x%p.\n",
-            tcb->id, addr, iptr);
+            tcb->id, addr, (void*) tcb->r[THREAD_REG_PC]);
     thread_print_info(tcb);
 
     thread_exit(tcb, THREAD_DESTROY_CODE);
     thread_switch();
+
+    latency_irqs_on();
+
 }
 
 /**
- * Fast Interrupt Request (FIQ)
+ * Handler for Data Aborts in a privileged mode, maps a reserved section of the current thread that
+ * the kernel accesses on its behalf. Any other abort during a system call terminates the calling
+ * thread and selects the next one, an abort anywhere else halts the kernel.
+ * Privileged writes to copy-on-write sections do not fault, the kernel resolves them beforehand.
+ * 
+ * @param pc        The address of the aborted instruction
+ * @param psr       The PSR of the aborted code
+ * 
+ * @return          0 if the aborted code can be resumed, 1 if the calling thread was terminated
  */
-__attribute__ ((interrupt ("FIQ")))
-void isr_fast_interrupt_request(void) {
-    void* iptr = read_link_register() - 8;
+__attribute__((section(".iram")))
+uint8_t interrupt_handle_kernel_data_abort(uint32_t pc, uint32_t psr) {
+
+    void* addr = (void*) cp15_read_fault_address();
+    uint32_t status = cp15_read_fault_status();
+    struct thread_tcb* tcb = thread_get_current();
+
+    if ((status & CP15_FSR_TYPE) == CP15_FSR_TRANSLATION_SECTION
+            && memmgmt_resolve_reserved(tcb->ttb, (uint32_t) addr)) {
+        return 0;
+    }
+
+    trace(TRACE_DATA_ABORT, (uint32_t) addr, pc);
+
+    // A system call runs with IRQs disabled on the Supervisor mode stack on behalf of the current
+    // thread, so the thread that passed the bad address is terminated like on a user abort
+    if ((psr & INTERRUPT_MODE_MASK) == INTERRUPT_MODE_SVC && !interrupt_nesting
+            && thread_cur_ctx == tcb->r) {
+        printf_isr("Data abort in system call of thread %x for attempted access of 0x%p detected "
+                "at address 0x%p.\n", tcb->id, addr, (void*) pc);
+        thread_print_info(tcb);
+
+        thread_exit(tcb, THREAD_DESTROY_CODE);
+        thread_switch();
+
+        // Ends the latency section of the system call
+        latency_irqs_on();
+        return 1;
+    }
+
+    // The kernel's state cannot be trusted anymore
+    printf_isr("Data abort in mode 0x%x for attempted access of 0x%p detected at address 0x%p.\n",
+            psr & INTERRUPT_MODE_MASK, addr, (void*) pc);
+    while(1);
 
-    printf_isr("Fast Interrupt request detected during execution at address 0x%p.\n", iptr);
 }
 
 /**
- * Interrupt Request (IRQ)
+ * Handler for Interrupt Requests, dispatches the AIC source.
+ * 
+ * @param pc        The address of the interrupted instruction
+ * @param psr       The PSR of the interrupted code
  */
-__attribute__ ((interrupt ("IRQ")))
-void isr_interrupt_request(void) {
-    char c;
-    struct thread_tcb* thread;
+__attribute__((section(".iram")))
+void interrupt_handle_irq(uint32_t pc, uint32_t psr) {
 
-    // Interrupt from the Period Interval Timer
-    if (timer_read_PIT_status()) {
-        thread_unblock_for_timer();
-        thread_switch();
-        return;
+    handler h;
+
+    interrupt_nesting++;
+
+    // Reading the IVR acknowledges the source with the highest priority and returns its handler.
+    // Until the end of the interrupt is signalled, the AIC only asserts sources of higher priority.
+    h = (handler)aic_read_ivr();
+    trace(TRACE_IRQ, (uint32_t) h, interrupt_nesting);
+
+#if INTERRUPT_NESTED
+    // Run the handler on the SVC stack with IRQs enabled so it can be preempted
+    interrupt_call_svc(h);
+#else
+    h();
+#endif
+
+    aic_end_of_interrupt();
+
+    // Sample the interrupted code on every tick. A nested IRQ cannot take the tick's sample since
+    // the AIC only lets sources of higher priority than the System Peripherals through.
+    if (h == &interrupt_system_peripherals && interrupt_pit_tick) {
+        interrupt_pit_tick = 0;
+        profile_sample(pc, psr);
     }
 
-    // Read an input character
-    if (dbgu_char_readable()) {
-        c = dbgu_read_char();
-        io_dbgu_write_input_char(c);
+    // Only the outermost IRQ runs deferred work and may switch threads, a nested one has interrupted
+    // a handler or deferred work which will pick up what has been raised
+    if (interrupt_nesting == 1) {
+        interrupt_run_deferred();
 
-        thread = thread_unblock_for_input();
-        if (thread) {
-            swi_str_read_resume(thread);
+        if (thread_switch_pending) {
+            thread_switch_pending = 0;
+            thread_switch();
         }
+    }
 
-        for (thread = thread_unblock_for_char(); thread != 0; thread = thread_unblock_for_char()) {
-            swi_getc_resume(thread, c);
+    interrupt_nesting--;
+
+}
+
+/* END Exception handlers called by the Interrupt Service Routines */
+
+
+/* BEGIN Interrupt handlers for the AIC sources */
+
+/**
+ * Handler for the System Peripherals source (ST, DBGU).
+ * The devices share one AIC source, so it only acknowledges them and defers the actual work.
+ */
+__attribute__((section(".iram")))
+void interrupt_system_peripherals(void) {
+
+    // Reading the timer's status acknowledges all of its interrupts at once
+    uint32_t timer_status = timer_read_status();
+
+    // Interrupt from the Period Interval Timer
+    if (timer_status & TIMER_STATUS_PIT) {
+        latency_tick();
+        defer_raise(DEFER_TIMER);
+        interrupt_pit_tick = 1;
+
+        // Use the idle time to zero memory in advance
+        if (!thread_sched_cur_idx) {
+            defer_raise(DEFER_ZERO);
         }
     }
 
-    // Write an output character
+    // Interrupt from the Real-time Alarm, i.e. a sleeping thread's deadline has been reached
+    if (timer_status & TIMER_STATUS_ALARM) {
+        defer_raise(DEFER_ALARM);
+    }
+
+    // A character can be read, mask the receiver until the deferred work has read it
+    if (dbgu_char_readable()) {
+        dbgu_rxrdy_interrupt_disable();
+        defer_raise(DEFER_DBGU_RX);
+    }
+
+    // A character can be written, mask the transmitter until the deferred work has written it
     if (dbgu_char_writable()) {
-        if (!io_dbgu_read_output_char(&c)) {
-            dbgu_txrdy_interrupt_disable();
-        } else {
-            dbgu_write_char(c);
-        }
+        dbgu_txrdy_interrupt_disable();
+        defer_raise(DEFER_DBGU_TX);
     }
+
 }
 
-/* END Interrupt Service Routines */
+/**
+ * Handler for spurious interrupts, i.e. when the AIC has no pending source to serve.
+ */
+__attribute__((section(".iram")))
+void interrupt_spurious(void) {
+}
+
+/* END Interrupt handlers for the AIC sources */
 
 
 /* BEGIN Functions for specific interrupts */
@@ -227,6 +548,143 @@ void interrupt_disable_fiq(void) {
 
 }
 
+/**
+ * Disables the IRQ signal and returns the previous CPSR.
+ * 
+ * @return          The CPSR before the IRQ signal was disabled
+ */
+__attribute__((section(".iram")))
+uint32_t interrupt_disable_irq_save(void) {
+
+    uint32_t cpsr;
+    asm volatile (
+        "mrs %[cpsr], CPSR \n\t"
+        "orr r3, %[cpsr], #0x80 \n\t"
+        "msr CPSR_c, r3 \n\t"
+        : [cpsr] "=r" (cpsr)
+        :
+        : "r3", "memory"
+    );
+
+    // Only a section that disables the IRQ signal is measured, not nested ones
+    if (!(cpsr & 0x80)) {
+        latency_irqs_off(__builtin_return_address(0));
+    }
+
+    return cpsr;
+
+}
+
+/**
+ * Disables the IRQ signal and returns the previous CPSR without starting an IRQ-disabled section of
+ * the latency measurement. For code that returns with IRQs disabled and leaves enabling them to an
+ * exception return, where no interrupt_restore_irq() would end the section.
+ * 
+ * @return          The CPSR before the IRQ signal was disabled
+ */
+__attribute__((section(".iram")))
+uint32_t interrupt_disable_irq_save_raw(void) {
+
+    uint32_t cpsr;
+    asm volatile (
+        "mrs %[cpsr], CPSR \n\t"
+        "orr r3, %[cpsr], #0x80 \n\t"
+        "msr CPSR_c, r3 \n\t"
+        : [cpsr] "=r" (cpsr)
+        :
+        : "r3", "memory"
+    );
+
+    return cpsr;
+
+}
+
+/**
+ * Restores the IRQ signal to the state saved in a given CPSR.
+ * 
+ * @param cpsr      The CPSR as returned by interrupt_disable_irq_save()
+ */
+__attribute__((section(".iram")))
+void interrupt_restore_irq(uint32_t cpsr) {
+
+    if (!(cpsr & 0x80)) {
+        latency_irqs_on();
+    }
+
+    asm volatile (
+        "mrs r3, CPSR \n\t"
+        "bic r3, r3, #0x80 \n\t"
+        "and %[cpsr], %[cpsr], #0x80 \n\t"
+        "orr r3, r3, %[cpsr] \n\t"
+        "msr CPSR_c, r3 \n\t"
+        : [cpsr] "+r" (cpsr)
+        :
+        : "r3", "memory"
+    );
+
+}
+
+/**
+ * Enables the IRQ signal inside an exception handler for work that would keep it disabled for too
+ * long, and returns the previous CPSR. The IRQs taken until interrupt_restore_irq_nested() are
+ * handled as nested ones, so they neither run deferred work nor switch threads. Both are left to
+ * the next outermost IRQ.
+ * 
+ * @return          The CPSR before the IRQ signal was enabled
+ */
+__attribute__((section(".iram")))
+uint32_t interrupt_enable_irq_nested(void) {
+
+    uint32_t cpsr;
+    asm volatile (
+        "mrs %[cpsr], CPSR \n\t"
+        : [cpsr] "=r" (cpsr)
+    );
+
+    if (cpsr & 0x80) {
+        latency_irqs_on();
+    }
+
+    // An IRQ must find the nesting raised before the signal is enabled
+    interrupt_nesting++;
+    asm volatile (
+        "bic r3, %[cpsr], #0x80 \n\t"
+        "msr CPSR_c, r3 \n\t"
+        :
+        : [cpsr] "r" (cpsr)
+        : "r3", "memory"
+    );
+
+    return cpsr;
+
+}
+
+/**
+ * Restores the IRQ signal to the state saved by interrupt_enable_irq_nested().
+ * 
+ * @param cpsr      The CPSR as returned by interrupt_enable_irq_nested()
+ */
+__attribute__((section(".iram")))
+void interrupt_restore_irq_nested(uint32_t cpsr) {
+
+    asm volatile (
+        "mrs r3, CPSR \n\t"
+        "bic r3, r3, #0x80 \n\t"
+        "and %[cpsr], %[cpsr], #0x80 \n\t"
+        "orr r3, r3, %[cpsr] \n\t"
+        "msr CPSR_c, r3 \n\t"
+        : [cpsr] "+r" (cpsr)
+        :
+        : "r3", "memory"
+    );
+    interrupt_nesting--;
+
+    if (cpsr & 0x80) {
+        latency_irqs_off(__builtin_return_address(0));
+    }
+
+}
+
 /**
  * Enables all interrupt signals.
  */
@@ -244,3 +702,166 @@ void interrupt_disable(void) {
 }
 
 /* END Functions for specific interrupts */
+
+
+/* BEGIN Functions for deferred work */
+
+/**
+ * Calls a function in Supervisor mode with IRQs enabled, on the SVC stack.
+ * The IRQ mode's SPSR and the Supervisor mode's LR are preserved, so the function may be preempted
+ * by another IRQ.
+ * Use only in the IRQ Interrupt Service Routine!
+ * 
+ * @param fn        The function to call
+ */
+__attribute__((section(".iram")))
+void interrupt_call_svc(void (*fn)(void)) {
+
+    asm volatile (
+        "mrs r1, SPSR \n\t"
+        "mrs r2, CPSR \n\t"
+        "bic r3, r2, #0x9F \n\t"              // clear the mode bits and the I bit ...
+        "orr r3, r3, #0x13 \n\t"              // ... and switch to Supervisor mode
+        "msr CPSR_c, r3 \n\t"
+        "stmfd sp!, {r1, r2, r3, lr} \n\t"    // SPSR_irq, CPSR_irq and the interrupted LR_svc
+        "mov lr, pc \n\t"
+        "bx %[fn] \n\t"
+        "ldmfd sp!, {r1, r2, r3, lr} \n\t"
+        "msr CPSR_c, r2 \n\t"                 // back to IRQ mode with IRQs disabled
+        "msr SPSR_cxsf, r1 \n\t"
+        :
+        : [fn] "r" (fn)
+        : "r0", "r1", "r2", "r3", "r12", "lr", "cc", "memory"
+    );
+
+}
+
+/**
+ * Runs all pending deferred work.
+ * If the IRQ has interrupted user mode, the work runs with IRQs enabled, otherwise with IRQs
+ * disabled.
+ * Use only in the IRQ Interrupt Service Routine!
+ */
+__attribute__((section(".iram")))
+void interrupt_run_deferred(void) {
+
+    uint32_t spsr;
+    asm volatile (
+        "mrs %[spsr], SPSR \n\t"
+        : [spsr] "=r" (spsr)
+    );
+
+    if ((spsr & INTERRUPT_MODE_MASK) == INTERRUPT_MODE_USER) {
+        interrupt_call_svc(&defer_run);
+    } else {
+        defer_run();
+    }
+
+}
+
+/**
+ * Deferred work for the Period Interval Timer: wakes up sleeping threads and requests a thread
+ * switch.
+ */
+__attribute__((section(".iram")))
+void interrupt_work_timer(void) {
+    kinfo_tick(timer_clock_to_ns(timer_read_clock()), thread_get_current()->id);
+    thread_unblock_for_timer();
+    thread_switch_pending = 1;
+}
+
+/**
+ * Deferred work for the Real-time Alarm: wakes up sleeping threads in between two ticks and requests
+ * a thread switch if the idle thread is running.
+ */
+__attribute__((section(".iram")))
+void interrupt_work_alarm(void) {
+    if (thread_unblock_for_timer() && !thread_sched_cur_idx) {
+        thread_switch_pending = 1;
+    }
+}
+
+/**
+ * Deferred work while the idle thread runs: zeroes memory in advance, one chunk at a time, until
+ * nothing is left to zero or another thread is ready to run.
+ */
+__attribute__((section(".iram")))
+void interrupt_work_zero(void) {
+
+    uint32_t cpsr;
+
+    if (thread_sched_cur_idx || thread_others_ready() || !memmgmt_refill_zero_pool()) {
+        return;
+    }
+
+    // Raising the work again lets the work the top halves have raised meanwhile run first
+    cpsr = interrupt_disable_irq_save();
+    defer_raise(DEFER_ZERO);
+    interrupt_restore_irq(cpsr);
+
+}
+
+/**
+ * Deferred work for the DBGU receiver: moves all received characters into the input buffer and
+ * resumes threads that are waiting for input.
+ */
+__attribute__((section(".iram")))
+void interrupt_work_dbgu_rx(void) {
+
+    char c;
+    struct thread_tcb* thread;
+
+    while (dbgu_char_readable()) {
+        c = dbgu_read_char();
+
+        // The debug keys are handled by the kernel and never reach the threads
+#if TRACE_ENABLED
+        if (c == TRACE_DUMP_KEY) {
+            trace_dump();
+            continue;
+        }
+#endif
+#if PROFILE_ENABLED
+        if (c == PROFILE_KEY) {
+            if (profile_active) {
+                profile_enable(0);
+                profile_dump();
+            } else {
+                profile_enable(1);
+            }
+            continue;
+        }
+#endif
+
+        io_dbgu_write_input_char(c);
+
+        thread = thread_unblock_for_input();
+        if (thread) {
+            swi_str_read_resume(thread);
+        }
+
+        for (thread = thread_unblock_for_char(); thread != 0; thread = thread_unblock_for_char()) {
+            swi_getc_resume(thread, c);
+        }
+    }
+
+    dbgu_rxrdy_interrupt_enable();
+
+}
+
+/**
+ * Deferred work for the DBGU transmitter: writes the next character from the output buffer.
+ */
+__attribute__((section(".iram")))
+void interrupt_work_dbgu_tx(void) {
+
+    char c;
+
+    if (io_dbgu_read_output_char(&c)) {
+        dbgu_write_char(c);
+        dbgu_txrdy_interrupt_enable();
+    }
+
+}
+
+/* END Functions for deferred work */
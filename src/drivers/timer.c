@@ -12,6 +12,7 @@
 
 
 #include "drivers/timer.h"
+#include "drivers/interrupt.h"
 #include "drivers/util.h"
 #include "lib/inttypes.h"
 
@@ -167,6 +168,10 @@
 /* END Register specifications */
 
 
+uint32_t timer_clock_last;
+uint64_t timer_clock_base;
+
+
 
 
 /* BEGIN Functions to interact with the hardware directly */
@@ -177,10 +182,12 @@ void timer_init_periodical(uint16_t slck_period) {
 }
 
 void timer_init_real_time(uint16_t slck_period) {
+    // The increments are read from ST_CRTR, an interrupt for each of them would only be overhead
     write_u32(ST_BASE, ST_RTMR, slck_period);
-    write_u32(ST_BASE, ST_IER, ST_RTTINC);
+    write_u32(ST_BASE, ST_IDR, ST_RTTINC);
 }
 
+__attribute__((section(".iram")))
 uint32_t timer_read_status(void) {
     return read_u32(ST_BASE, ST_SR);
 }
@@ -193,26 +200,130 @@ uint32_t timer_read_RTTINC_status(void) {
     return timer_read_status() & ST_RTTINC;
 }
 
+__attribute__((section(".iram")))
+uint32_t timer_read_real_time(void) {
+
+    uint32_t crtr;
+
+    // The register is updated asynchronously to the processor clock, read it until it is stable
+    do {
+        crtr = read_u32(ST_BASE, ST_CRTR);
+    } while (crtr != read_u32(ST_BASE, ST_CRTR));
+
+    return crtr;
+
+}
+
+__attribute__((section(".iram")))
+void timer_alarm_enable(uint32_t value) {
+    write_u32(ST_BASE, ST_RTAR, value & (TIMER_CLOCK_WRAP - 1));
+    write_u32(ST_BASE, ST_IER, ST_ALMS);
+}
+
+__attribute__((section(".iram")))
+void timer_alarm_disable(void) {
+    write_u32(ST_BASE, ST_IDR, ST_ALMS);
+}
+
 /* END Functions to interact with the hardware directly */
 
 
 /* BEGIN Functions abstracting direct hardware access */
 
-void timer_clksleep(uint16_t ms) {
+/**
+ * Returns the monotonic clock, i.e. the number of slow clock cycles since the Real-time Timer has
+ * been started.
+ * This has to be called at least once per wrap-around of the Real-time Timer (32 s).
+ * 
+ * @return          The clock in units of 1/TIMER_CLOCK_HZ seconds
+ */
+__attribute__((section(".iram")))
+uint64_t timer_read_clock(void) {
 
-    uint32_t time_start;
-    uint32_t time_now;
-    uint32_t time_end;
-    time_start = read_u32(ST_BASE, ST_CRTR);
-    time_now = time_start;
-    time_end = time_start + ms;
-    if (time_end >= 1048576) {
-        time_end = 1048575;
+    uint32_t cpsr = interrupt_disable_irq_save();
+    uint32_t crtr = timer_read_real_time();
+    uint64_t clock;
+
+    if (crtr < timer_clock_last) {
+        timer_clock_base += TIMER_CLOCK_WRAP;
     }
-    while (time_end > time_now) {
-        time_now = read_u32(ST_BASE, ST_CRTR);
+    timer_clock_last = crtr;
+    clock = timer_clock_base + crtr;
+
+    interrupt_restore_irq(cpsr);
+    return clock;
+
+}
+
+/**
+ * Converts a clock value into nanoseconds.
+ * 
+ * @param clock     The clock value
+ * 
+ * @return          The clock value in nanoseconds
+ */
+__attribute__((section(".iram")))
+uint64_t timer_clock_to_ns(uint64_t clock) {
+    // 10^9 / 32768 = 1953125 / 64, this overflows after more than 9 years
+    return (clock * 1953125) >> 6;
+}
+
+/**
+ * Converts a clock value into milliseconds, rounded down.
+ * 
+ * @param clock     The clock value
+ * 
+ * @return          The clock value in milliseconds
+ */
+__attribute__((section(".iram")))
+uint32_t timer_clock_to_ms(uint64_t clock) {
+    return (clock * 1000) >> 15;
+}
+
+/**
+ * Converts milliseconds into a clock value, rounded up.
+ * 
+ * @param ms        The number of milliseconds
+ * 
+ * @return          The clock value that spans at least the given time
+ */
+__attribute__((section(".iram")))
+uint64_t timer_ms_to_clock(uint32_t ms) {
+    // 32768 / 1000 = 32.768, the fractional part is multiplied by 2^32 to avoid a division
+    return (uint64_t) ms * 32 + (((uint64_t) ms * 3298534884u) >> 32) + 1;
+}
+
+/**
+ * Sets the alarm to a given clock value, or disables it if the value is not within the next
+ * wrap-around of the Real-time Timer.
+ * 
+ * @param clock     The clock value at which the alarm should fire
+ */
+__attribute__((section(".iram")))
+void timer_set_alarm(uint64_t clock) {
+
+    uint64_t now = timer_read_clock();
+
+    if (clock <= now || clock - now >= TIMER_CLOCK_WRAP) {
+        timer_alarm_disable();
+        return;
     }
 
+    timer_alarm_enable((uint32_t) clock);
+
+}
+
+/**
+ * Busy-waits for a given amount of time.
+ * 
+ * @param ms        The number of milliseconds to wait
+ */
+void timer_clksleep(uint16_t ms) {
+
+    uint64_t time_end = timer_read_clock() + timer_ms_to_clock(ms);
+
+    while (timer_read_clock() < time_end);
+
 }
 
 /* END Functions abstracting direct hardware access */
@@ -12,10 +12,12 @@
 
 /* BEGIN Functions to read and write to memory directly */
 
+__attribute__((section(".iram")))
 inline void write_u32(uint32_t base, uint32_t offset, uint32_t val) {
     *(volatile uint32_t *)(base + offset) = val;
 }
 
+__attribute__((section(".iram")))
 inline uint32_t read_u32(uint32_t base, uint32_t offset) {
     return *(volatile uint32_t *)(base + offset);
 }
@@ -28,10 +30,12 @@ inline uint16_t read_u16(uint32_t base, uint32_t offset) {
     return *(volatile uint16_t *)(base + offset);
 }
 
+__attribute__((section(".iram")))
 inline void write_u8(uint32_t base, uint32_t offset, uint8_t val) {
     *(volatile uint8_t *)(base + offset) = val;
 }
 
+__attribute__((section(".iram")))
 inline uint8_t read_u8(uint32_t base, uint32_t offset) {
     return *(volatile uint8_t *)(base + offset);
 }
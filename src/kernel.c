@@ -6,13 +6,17 @@
  */
 
 
+#include "config.h"
 #include "drivers/aic.h"
 #include "drivers/cp15.h"
 #include "drivers/dbgu.h"
 #include "drivers/init.h"
+#include "drivers/interrupt.h"
 #include "drivers/timer.h"
 #include "sys/io.h"
+#include "sys/kinfo.h"
 #include "sys/kmem.h"
+#include "sys/latency.h"
 #include "sys/memmgmt.h"
 #include "sys/sysio.h"
 #include "sys/thread.h"
@@ -24,10 +28,32 @@
 __attribute__((section(".lib")))
 void main(void);
 
+/**
+ * Initializes the system and starts the first thread.
+ */
+__attribute__((noreturn))
+void kernel_main(void);
 
+
+/**
+ * The entry point of the kernel image.
+ * Only sets up the stacks, as a naked function cannot have a stack frame of its own.
+ */
 __attribute__((naked, section(".init")))
 void _start() {
     init_stacks();
+    kernel_main();
+}
+
+/**
+ * Initializes the system and starts the first thread.
+ */
+void kernel_main(void) {
+
+    struct thread_tcb* thread;
+
+    // Move the interrupt and syscall handling code into the internal RAM
+    init_iram();
 
     // Init the kernel memory management
     // kmem_init((void*) KMEM_START, KMEM_SIZE);
@@ -46,27 +72,40 @@ void _start() {
     init_ivt();
 
     printf_isr("Initializing Advanced Interrupt Controller.\n");
-    aic_enable_system_peripherals();
+    aic_init(&interrupt_spurious);
+    aic_register(AIC_SOURCE_SYS, AIC_PRIO_HIGHEST, AIC_TRIGGER_LEVEL, &interrupt_system_peripherals);
 
     printf_isr("Initializing allocation table.\n");
     memmgmt_init_allocation_table();
 
+    printf_isr("Initializing zeroed page pool.\n");
+    memmgmt_init_zero_pool();
+
+    printf_isr("Initializing kernel information page.\n");
+    kinfo_init();
+
     printf_isr("Initializing thread management.\n");
     thread_init_management();
 
     printf_isr("Initializing CP15 domains.\n");
     cp15_init_domains();
 
+    printf_isr("Locking down the kernel's translations.\n");
+    memmgmt_init_lockdown(thread_tcb_list[0].ttb);
+    thread_cur_ttb = thread_tcb_list[0].ttb;
+
     printf_isr("Welcome to ChaOS.\n");
 
-    struct thread_tcb* thread = thread_create(&main, 0, 0, 0);
+    thread = thread_create(&main, 0, 0, 0);
     if (thread) {
         thread_activate(thread->id);
     }
 
-    timer_init_real_time(32);
-    timer_init_periodical(32);
+    timer_init_real_time(1);
+    timer_init_periodical(CONFIG_TICK_PERIOD);
+    latency_init(CONFIG_TICK_PERIOD);
     // Nothing should be executed after this line
 
     while(1);
+
 }
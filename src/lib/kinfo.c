@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Application library for reading the kernel information page without system calls.
+ */
+
+
+#include "lib/kinfo.h"
+
+
+/**
+ * Reads a consistent snapshot of the kernel information page.
+ * 
+ * @param info      Pointer to the struct to copy the snapshot into
+ */
+__attribute__((section(".lib")))
+void kinfo_read(struct kinfo* info) {
+
+    volatile struct kinfo* page = (volatile struct kinfo*) KINFO_ADDR;
+    uint32_t seq;
+
+    do {
+        // Wait until no update is in progress
+        while ((seq = page->seq) & 1);
+
+        info->seq       = seq;
+        info->ticks     = page->ticks;
+        info->time      = page->time;
+        info->tid       = page->tid;
+        info->switches  = page->switches;
+        info->idle      = page->idle;
+    } while (seq != page->seq);
+
+}
+
+/**
+ * Returns the number of Period Interval Timer ticks since boot.
+ * 
+ * @return          The number of ticks
+ */
+__attribute__((section(".lib")))
+uint32_t kinfo_ticks(void) {
+    return ((volatile struct kinfo*) KINFO_ADDR)->ticks;
+}
+
+/**
+ * Returns the monotonic time at the last tick. It has the granularity of a tick, as the user cannot
+ * read the System Timer to add the time since then. clock_gettime() returns the exact time with a
+ * system call.
+ * 
+ * @return          The time in ns
+ */
+__attribute__((section(".lib")))
+uint64_t kinfo_time(void) {
+
+    struct kinfo info;
+
+    kinfo_read(&info);
+    return info.time;
+
+}
+
+/**
+ * Returns the ID of the current thread.
+ * 
+ * @return          The current thread's ID
+ */
+__attribute__((section(".lib")))
+uint32_t kinfo_tid(void) {
+    return ((volatile struct kinfo*) KINFO_ADDR)->tid;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Application library for reading the kernel's interrupt latency statistics.
+ */
+
+
+#include "lib/latency.h"
+
+
+/**
+ * Reads the kernel's interrupt latency statistics, which are only collected if the kernel has been
+ * built with CONFIG_LATENCY (e.g. with the trace profile), all zero otherwise.
+ * 
+ * @param report    Pointer to the struct to write the statistics into
+ * @param reset     Whether the statistics should be cleared afterwards
+ * 
+ * @return          0 on success, -1 if the struct is not writable user memory
+ */
+__attribute__((section(".lib")))
+int32_t latency_read(struct latency_report* report, uint8_t reset) {
+
+    int32_t result;
+
+    asm volatile(
+        "mov r7, %[report] \n"
+        "mov r8, %[reset] \n"
+        "swi 0x43 \n"
+        "mov %[result], r7"
+        : [result] "=r" (result)
+        : [report] "r" (report), [reset] "r" (reset)
+        : "r7", "r8", "memory"
+    );
+
+    return result;
+
+}
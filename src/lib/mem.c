@@ -21,7 +21,7 @@ __attribute__((section(".lib")))
 void memcopy(uint8_t* dst, uint8_t* src, size_t size) {
 
     for (; size > 0; size--) {
-        dst[size] = src[size];
+        dst[size - 1] = src[size - 1];
     }
 
 }
@@ -36,29 +36,7 @@ __attribute__((section(".lib")))
 void memzero(uint8_t* dst, size_t size) {
 
     for (; size > 0; size--) {
-        dst[size] = 0;
+        dst[size - 1] = 0;
     }
 
 }
-
-/**
- * Maps a memory segment to the given address.
- * 
- * @param addr  The address to be mapped
- * 
- * @return      Whether the mapping was successful
- */
-__attribute__((section(".lib")))
-uint32_t mmap(uint32_t addr) {
-    uint32_t result;
-
-    asm volatile(
-        "mov r7, %[addr] \n"
-        "swi 0x30 \n"
-        "mov %[result], r7"
-        : [result] "=r" (result)
-        : [addr] "r" (addr)
-        : "r7"
-    );
-    return result;
-}
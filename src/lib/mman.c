@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Application library for mapping memory into the address space.
+ */
+
+
+#include "lib/mman.h"
+#include "lib/inttypes.h"
+
+
+/**
+ * Maps memory into the address space. The mapping covers all sections that the range touches,
+ * they are allocated and zeroed on their first access.
+ * 
+ * @param addr      With MAP_FIXED the address to map at, otherwise where to start looking for
+ *                  free sections
+ * @param length    The length of the range in bytes
+ * @param prot      The protection bits (PROT_*)
+ * @param flags     The flags (MAP_*)
+ * 
+ * @return          `addr` with MAP_FIXED, the first address of the mapping otherwise, or
+ *                  MAP_FAILED if there was an error
+ */
+__attribute__((section(".lib")))
+void* mmap(void* addr, size_t length, uint32_t prot, uint32_t flags) {
+
+    void* result;
+
+    asm volatile(
+        "mov r7, %[addr] \n"
+        "mov r8, %[length] \n"
+        "mov r9, %[prot] \n"
+        "mov r10, %[flags] \n"
+        "swi 0x30 \n"
+        "mov %[result], r7"
+        : [result] "=r" (result)
+        : [addr] "r" (addr), [length] "r" (length), [prot] "r" (prot), [flags] "r" (flags)
+        : "r7", "r8", "r9", "r10", "memory"
+    );
+
+    return result;
+
+}
+
+/**
+ * Unmaps all sections a range of mapped memory touches and frees their pages.
+ * 
+ * @param addr      The first address of the range
+ * @param length    The length of the range in bytes
+ * 
+ * @return          1 iff the range could be unmapped, 0 otherwise
+ */
+__attribute__((section(".lib")))
+uint32_t munmap(void* addr, size_t length) {
+
+    uint32_t result;
+
+    asm volatile(
+        "mov r7, %[addr] \n"
+        "mov r8, %[length] \n"
+        "swi 0x31 \n"
+        "mov %[result], r7"
+        : [result] "=r" (result)
+        : [addr] "r" (addr), [length] "r" (length)
+        : "r7", "r8", "memory"
+    );
+
+    return result;
+
+}
+
+/**
+ * Changes the protection of all sections a range of mapped memory touches.
+ * 
+ * @param addr      The first address of the range
+ * @param length    The length of the range in bytes
+ * @param prot      The new protection bits (PROT_*)
+ * 
+ * @return          1 iff the protection could be changed, 0 otherwise
+ */
+__attribute__((section(".lib")))
+uint32_t mprotect(void* addr, size_t length, uint32_t prot) {
+
+    uint32_t result;
+
+    asm volatile(
+        "mov r7, %[addr] \n"
+        "mov r8, %[length] \n"
+        "mov r9, %[prot] \n"
+        "swi 0x32 \n"
+        "mov %[result], r7"
+        : [result] "=r" (result)
+        : [addr] "r" (addr), [length] "r" (length), [prot] "r" (prot)
+        : "r7", "r8", "r9", "memory"
+    );
+
+    return result;
+
+}
+
+/**
+ * Reads the memory usage of the calling thread's address space.
+ * 
+ * @param stats     Pointer to the struct to write the usage into
+ * 
+ * @return          0 on success, -1 if the struct is not writable user memory
+ */
+__attribute__((section(".lib")))
+int32_t mem_stats(struct mem_stats* stats) {
+
+    int32_t result;
+
+    asm volatile(
+        "mov r7, %[stats] \n"
+        "swi 0x33 \n"
+        "mov %[result], r7"
+        : [result] "=r" (result)
+        : [stats] "r" (stats)
+        : "r7", "memory"
+    );
+
+    return result;
+
+}
+
+/**
+ * Limits the sections the calling thread's address space may have mapped, resident or reserved.
+ * Mappings beyond the limit fail, and processes created afterwards inherit it. The limit is a hard
+ * one: once set, it can only be lowered.
+ * 
+ * @param sections  The new limit
+ * 
+ * @return          1 iff the limit was set, 0 if it would be raised or removed
+ */
+__attribute__((section(".lib")))
+uint32_t mem_limit(uint32_t sections) {
+
+    uint32_t result;
+
+    asm volatile(
+        "mov r7, %[sections] \n"
+        "swi 0x34 \n"
+        "mov %[result], r7"
+        : [result] "=r" (result)
+        : [sections] "r" (sections)
+        : "r7", "memory"
+    );
+
+    return result;
+
+}
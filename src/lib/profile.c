@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Application library for the sampling profiler.
+ */
+
+
+#include "lib/profile.h"
+
+
+/**
+ * Discards all samples and starts sampling on every tick.
+ */
+__attribute__((section(".lib")))
+void profile_start(void) {
+
+    asm volatile(
+        "mov r7, #1 \n"
+        "swi 0x41 \n"
+        :
+        :
+        : "r7", "memory"
+    );
+
+}
+
+/**
+ * Stops sampling, the samples taken so far can still be read.
+ */
+__attribute__((section(".lib")))
+void profile_stop(void) {
+
+    asm volatile(
+        "mov r7, #0 \n"
+        "swi 0x41 \n"
+        :
+        :
+        : "r7", "memory"
+    );
+
+}
+
+/**
+ * Moves the oldest samples out of the kernel's sample buffer.
+ * 
+ * @param samples   Pointer to the array to write the samples into
+ * @param max       The number of entries in the array
+ * 
+ * @return          The number of samples written, -1 if the array is not writable user memory
+ */
+__attribute__((section(".lib")))
+uint32_t profile_read(struct profile_sample* samples, uint32_t max) {
+
+    uint32_t num;
+
+    asm volatile(
+        "mov r7, %[samples] \n"
+        "mov r8, %[max] \n"
+        "swi 0x42 \n"
+        "mov %[num], r7"
+        : [num] "=r" (num)
+        : [samples] "r" (samples), [max] "r" (max)
+        : "r7", "r8", "memory"
+    );
+
+    return num;
+
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Application library for reading scheduler statistics.
+ */
+
+
+#include "lib/stats.h"
+
+
+/**
+ * Takes a snapshot of the statistics of all threads.
+ * 
+ * @param stats     Pointer to the array to write the snapshot into
+ * @param max       The number of entries in the array
+ * 
+ * @return          The number of entries written, -1 if the array is not writable user memory
+ */
+__attribute__((section(".lib")))
+uint32_t thread_stats(struct thread_stats* stats, uint32_t max) {
+
+    uint32_t num;
+
+    asm volatile(
+        "mov r7, %[stats] \n"
+        "mov r8, %[max] \n"
+        "swi 0x26 \n"
+        "mov %[num], r7"
+        : [num] "=r" (num)
+        : [stats] "r" (stats), [max] "r" (max)
+        : "r7", "r8", "memory"
+    );
+
+    return num;
+
+}
@@ -24,11 +24,13 @@ int printf(const char* format, ...) {
 
     #define MAXSIZE 512
 
-    /* Retrieve the number of arguments by parsing the format string for % chars */
     char target[MAXSIZE]; // This is the target buffer for our final interpolated string
     size_t size; // This will be the number of bytes written
+    __builtin_va_list args;
 
-    size = interpolate_core(target, MAXSIZE, format, &format + 1);
+    __builtin_va_start(args, format);
+    size = interpolate_va(target, MAXSIZE, format, args);
+    __builtin_va_end(args);
     target[MAXSIZE - 1] = 0; // Ensure there is a 0 terminator
 
     if (write_string(target, size-1) != size-1) {
@@ -47,7 +49,7 @@ int printf(const char* format, ...) {
  * @param target    Pointer to the buffer to read bytes to
  * @param size      The number of bytes to read
  * 
- * @return          The number of bytes read
+ * @return          The number of bytes read, 0xFFFFFFFF if the buffer is not writable user memory
  */
 __attribute__((section(".lib")))
 size_t read_string(char* target, size_t size) {
@@ -59,7 +61,7 @@ size_t read_string(char* target, size_t size) {
         "mov %[c], r7"
         : [c] "=r" (c)
         : [target] "r" (target), [size] "r" (size)
-        : "r7", "r8"
+        : "r7", "r8", "memory"
     );
     return c;
 }
@@ -71,6 +73,9 @@ __attribute__((section(".lib")))
 void read_flush(void) {
     asm volatile(
         "swi 0x12 \n"
+        :
+        :
+        : "memory"
     );
 }
 
@@ -87,7 +92,7 @@ char getc(void) {
         "mov %[c], r7"
         : [c] "=r" (c)
         :
-        : "r7"
+        : "r7", "memory"
     );
     return (char) c;
 }
@@ -98,7 +103,8 @@ char getc(void) {
  * @param source    Pointer to the buffer to write bytes from
  * @param size      The number of bytes to write
  * 
- * @return          The number of bytes written
+ * @return          The number of bytes written, 0xFFFFFFFF if the buffer is not readable user
+ *                  memory
  */
 __attribute__((section(".lib")))
 size_t write_string(char* source, size_t size) {
@@ -110,7 +116,7 @@ size_t write_string(char* source, size_t size) {
         "mov %[len], r7"
         : [len] "=r" (len)
         : [source] "r" (source), [size] "r" (size)
-        : "r7", "r8"
+        : "r7", "r8", "memory"
     );
     return len;
 }
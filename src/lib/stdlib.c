@@ -24,7 +24,7 @@ void exit(int32_t status) {
         "swi 0x21 \n"
         :
         : [status] "r" (status)
-        : "r7"
+        : "r7", "memory"
     );
 
 }
@@ -36,7 +36,7 @@ void exit(int32_t status) {
  * @param param1    The first parameter the new thread's function should be launched with
  * @param param2    The second parameter the new thread's function should be launched with
  * 
- * @return          The new thread's ID
+ * @return          The new thread's ID, 0xFFFFFFFF if it could not be created
  */
 __attribute__((section(".lib")))
 uint32_t launch(void* text, uint32_t param1, uint32_t param2) {
@@ -52,7 +52,7 @@ uint32_t launch(void* text, uint32_t param1, uint32_t param2) {
         "mov %[child_id], r7"
         : [child_id] "=r" (child_id)
         : [text] "r" (text), [param1] "r" (param1), [param2] "r" (param2)
-        : "r7", "r8", "r9", "r10"
+        : "r7", "r8", "r9", "r10", "memory"
     );
 
     return child_id;
@@ -66,7 +66,7 @@ uint32_t launch(void* text, uint32_t param1, uint32_t param2) {
  * @param param1    The first parameter the new task thread's function should be launched with
  * @param param2    The second parameter the new task thread's function should be launched with
  * 
- * @return          The new task thread's ID
+ * @return          The new task thread's ID, 0xFFFFFFFF if it could not be created
  */
 __attribute__((section(".lib")))
 uint32_t launch_task(void* text, uint32_t param1, uint32_t param2) {
@@ -82,7 +82,30 @@ uint32_t launch_task(void* text, uint32_t param1, uint32_t param2) {
         "mov %[child_id], r7"
         : [child_id] "=r" (child_id)
         : [text] "r" (text), [param1] "r" (param1), [param2] "r" (param2)
-        : "r7", "r8", "r9", "r10"
+        : "r7", "r8", "r9", "r10", "memory"
+    );
+
+    return child_id;
+
+}
+
+/**
+ * Creates a copy of the calling thread in a new address space. Both continue after the call, the
+ * copy's memory is shared with the caller's until one of them writes to it.
+ * 
+ * @return          The copy's ID in the caller, 0 in the copy, -1 if there was an error
+ */
+__attribute__((section(".lib")))
+int32_t fork(void) {
+
+    int32_t child_id;
+
+    asm volatile(
+        "swi 0x27 \n"
+        "mov %[child_id], r7"
+        : [child_id] "=r" (child_id)
+        :
+        : "r7", "memory"
     );
 
     return child_id;
@@ -108,11 +131,94 @@ uint32_t sleep(uint32_t ms) {
         "mov %[remaining], r7"
         : [remaining] "=r" (remaining)
         : [ms] "r" (ms)
-        : "r7"
+        : "r7", "memory"
     );
 
     return remaining;
 
 }
 
+/**
+ * Yields the processor to the next thread that is ready to run.
+ * Returns immediately if there is no such thread.
+ */
+__attribute__((section(".lib")))
+void yield(void) {
+
+    asm volatile(
+        "swi 0x20 \n"
+        :
+        :
+        : "memory"
+    );
+
+}
+
+/**
+ * Returns the ID of the current thread.
+ * 
+ * @return          The current thread's ID
+ */
+__attribute__((section(".lib")))
+uint32_t gettid(void) {
+
+    uint32_t id;
+
+    asm volatile(
+        "swi 0x24 \n"
+        "mov %[id], r7"
+        : [id] "=r" (id)
+        :
+        : "r7", "memory"
+    );
+
+    return id;
+
+}
+
+/**
+ * Returns the monotonic time since boot with the resolution of the slow clock (about 30 us).
+ * 
+ * @return          The time in ns
+ */
+__attribute__((section(".lib")))
+uint64_t clock_gettime(void) {
+
+    uint32_t low;
+    uint32_t high;
+
+    asm volatile(
+        "swi 0x25 \n"
+        "mov %[low], r7 \n"
+        "mov %[high], r8"
+        : [low] "=r" (low), [high] "=r" (high)
+        :
+        : "r7", "r8", "memory"
+    );
+
+    return (uint64_t) high << 32 | low;
+
+}
+
 /* END Thread management functions */
+
+
+/* BEGIN Debugging functions */
+
+/**
+ * Writes the kernel's trace buffer to the DBGU in binary, see tools/trace_decode.py.
+ * The whole system stalls while the trace is written.
+ */
+__attribute__((section(".lib")))
+void dump_trace(void) {
+
+    asm volatile(
+        "swi 0x40 \n"
+        :
+        :
+        : "memory"
+    );
+
+}
+
+/* END Debugging functions */
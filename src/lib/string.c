@@ -8,6 +8,7 @@
 
 #include "lib/string.h"
 #include "lib/inttypes.h"
+#include "lib/mem.h"
 
 
 /* Holds all hex characters in one place. */
@@ -34,7 +35,8 @@ void to_hex(char* target, uint32_t arg) {
  * Interpolates a format string with given arguments and writes it into a given target buffer.
  * cur_arg points to the location of the first argument.
  * This function is not meant to be used on its own to avoid mistakes with the addresses.
- * Use a variate function that wraps around it instead, e.g. printf() or interpolate().
+ * Use a variate function that wraps around it instead, e.g. printf() or interpolate(), or
+ * interpolate_va().
  * 
  * @param target    Pointer to the target buffer for the interpolated string
  * @param cap       Capacity of the target buffer
@@ -94,14 +96,16 @@ size_t interpolate_core(char* target, size_t cap, const char* format, void* cur_
 
                 to_hex(&target[target_idx], word);
                 target_idx += sizeof(uint32_t) * 2; // two hex chars per byte
+                cap -= sizeof(uint32_t) * 2;
                 break;
 
             default: // not an interpolation
                 target[target_idx++] = '%';
                 --cap;
 
-                if (cap--) {
+                if (cap) {
                     target[target_idx++] = cur_char;
+                    --cap;
                 }
                 break;
             }
@@ -128,9 +132,60 @@ size_t interpolate_core(char* target, size_t cap, const char* format, void* cur_
 
 }
 
+/**
+ * Interpolates a format string with the arguments of a variate function and writes it into a given
+ * target buffer.
+ * The arguments are collected into a consecutive memory area for interpolate_core(), as only
+ * unoptimised builds happen to leave them there. At most INTERPOLATE_MAX_ARGS arguments are used.
+ * 
+ * @param target    Pointer to the target buffer for the interpolated string
+ * @param cap       Capacity of the target buffer
+ * @param format    Pointer to the format string
+ * @param args      The variate function's arguments after the format string
+ * 
+ * @return          The number of characters in the interpolated string (including null terminator)
+ */
+__attribute__((section(".lib")))
+size_t interpolate_va(char* target, size_t cap, const char* format, __builtin_va_list args) {
+
+    char* collected[INTERPOLATE_MAX_ARGS];
+    uint8_t* cur_arg = (uint8_t*) collected;
+    uint8_t* end = cur_arg + sizeof(collected);
+    uint32_t word;
+    char* string_ptr;
+    uint32_t i;
+
+    // Lay out the arguments exactly as interpolate_core() reads them
+    for (i = 0; format[i] && cur_arg < end; i++) {
+        if (format[i] != '%' || !format[i + 1]) {
+            continue;
+        }
+        switch (format[++i]) {
+
+        case 'c':
+        case 'x':
+        case 'p':
+            word = __builtin_va_arg(args, uint32_t);
+            memcopy(cur_arg, (uint8_t*) &word, sizeof(uint32_t));
+            cur_arg += sizeof(uint32_t);
+            break;
+
+        case 's':
+            string_ptr = __builtin_va_arg(args, char*);
+            memcopy(cur_arg, (uint8_t*) &string_ptr, sizeof(char*));
+            cur_arg += sizeof(char*);
+            break;
+
+        }
+    }
+
+    return interpolate_core(target, cap, format, collected);
+
+}
+
 /**
  * Interpolates a format string with given arguments and writes it into a given target buffer.
- * This is a wrapper around interpolate_core() so we can call it as a variate function.
+ * This is a wrapper around interpolate_va() so we can call it as a variate function.
  * 
  * @param target    Pointer to the target buffer for the interpolated string
  * @param format    Pointer to the format string
@@ -141,7 +196,16 @@ size_t interpolate_core(char* target, size_t cap, const char* format, void* cur_
 __attribute__((format(printf, 3, 4)))
 __attribute__((section(".lib")))
 size_t interpolate(char* target, size_t cap, const char* format, ...) {
-    return interpolate_core(target, cap, format, &format + 1);
+
+    __builtin_va_list args;
+    size_t size;
+
+    __builtin_va_start(args, format);
+    size = interpolate_va(target, cap, format, args);
+    __builtin_va_end(args);
+
+    return size;
+
 }
 
 /**
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Functions for deferred work (bottom halves) that is scheduled by Interrupt Service Routines.
+ */
+
+
+#include "sys/defer.h"
+#include "drivers/interrupt.h"
+#include "lib/inttypes.h"
+#include "sys/trace.h"
+
+
+typedef void (*work_func)(void);
+
+
+volatile uint32_t defer_pending;
+
+
+/**
+ * Runs all pending deferred work items until none are left.
+ * The work items themselves run with the IRQ state this function was called with, new work raised
+ * by interrupts in the meantime is picked up before returning.
+ * 
+ * This function always returns with IRQs disabled.
+ */
+__attribute__((section(".iram")))
+void defer_run(void) {
+
+    uint32_t pending;
+    uint32_t cpsr;
+    uint8_t i;
+
+    // IRQs stay disabled from the last check until the exception return, which does not end an
+    // IRQ-disabled section, so these do not start one
+    cpsr = interrupt_disable_irq_save_raw();
+
+    while (defer_pending) {
+        // Take all pending work at once so the top halves can raise new work while we run
+        pending = defer_pending;
+        defer_pending = 0;
+        interrupt_restore_irq(cpsr);
+
+        trace(TRACE_DEFER, pending, 0);
+
+        for (i = 0; pending; i++, pending >>= 1) {
+            if (pending & 1) {
+                ((work_func)defer_functions[i])();
+            }
+        }
+
+        interrupt_disable_irq_save_raw();
+    }
+
+}
+
+
+/* BEGIN Deferred work management tables */
+
+void* defer_functions[] = {
+    &interrupt_work_timer,
+    &interrupt_work_dbgu_rx,
+    &interrupt_work_dbgu_tx,
+    &interrupt_work_alarm,
+    &interrupt_work_zero
+};
+
+/* END Deferred work management tables */
@@ -7,14 +7,15 @@
 
 
 #include "sys/io.h"
+#include "config.h"
 #include "drivers/dbgu.h"
 #include "drivers/interrupt.h"
 #include "lib/inttypes.h"
 #include "lib/buffer.h"
 
 
-#define IO_DBGU_INPUT_BUFFER    512
-#define IO_DBGU_OUTPUT_BUFFER   4096
+#define IO_DBGU_INPUT_BUFFER    CONFIG_DBGU_INPUT_BUFFER
+#define IO_DBGU_OUTPUT_BUFFER   CONFIG_DBGU_OUTPUT_BUFFER
 
 
 struct ring_buffer io_dbgu_input_buffer;
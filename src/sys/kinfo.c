@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Functions for the kernel information page that is mapped read-only into every address space.
+ */
+
+
+#include "sys/kinfo.h"
+#include "drivers/interrupt.h"
+#include "lib/inttypes.h"
+#include "lib/mem.h"
+
+
+/**
+ * Initializes the kernel information page.
+ */
+void kinfo_init(void) {
+    memzero((uint8_t*) KINFO_ADDR, sizeof(struct kinfo));
+}
+
+/**
+ * Publishes a Period Interval Timer tick.
+ * 
+ * @param time      The current monotonic time in ns
+ * @param tid       The ID of the thread that has been running during the tick
+ */
+__attribute__((section(".iram")))
+void kinfo_tick(uint64_t time, uint32_t tid) {
+
+    volatile struct kinfo* page = (volatile struct kinfo*) KINFO_ADDR;
+    uint32_t cpsr = interrupt_disable_irq_save();
+
+    page->seq++;
+    page->ticks++;
+    page->time = time;
+    if (tid == 1) {
+        page->idle++;
+    }
+    page->seq++;
+
+    interrupt_restore_irq(cpsr);
+
+}
+
+/**
+ * Publishes a thread switch.
+ * 
+ * @param tid       The ID of the thread that runs from now on
+ */
+__attribute__((section(".iram")))
+void kinfo_switch(uint32_t tid) {
+
+    volatile struct kinfo* page = (volatile struct kinfo*) KINFO_ADDR;
+    uint32_t cpsr = interrupt_disable_irq_save();
+
+    page->seq++;
+    page->tid = tid;
+    page->switches++;
+    page->seq++;
+
+    interrupt_restore_irq(cpsr);
+
+}
@@ -305,10 +305,10 @@ void kmem_free(struct kmem_header* header, void* ptr) {
         header = other;
     }
 
-    // Maybe we can join the allocation with the next one?
+    // Maybe we can join the allocation with the next one? (The last header is never joined.)
     other = kmem_next(header);
     if (other && !kmem_is_reserved(other)) {
-        kmem_join(header);
+        kmem_join(other);
     }
 
 }
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Functions for measuring the interrupt latency and the durations of IRQ-disabled sections.
+ */
+
+
+#include "sys/latency.h"
+#include "drivers/timer.h"
+#include "lib/inttypes.h"
+#include "lib/mem.h"
+
+
+#if LATENCY_ENABLED
+
+struct latency_report latency_stats;
+
+// The Period Interval Timer and the Real-time Timer both count slow clock cycles, so a tick occurs
+// whenever the Real-time Timer's value has the phase it had when the Period Interval Timer started
+uint32_t latency_pit_phase;
+uint32_t latency_pit_mask;
+
+// The start of the current IRQ-disabled section and where it was started from, 0 if there is none
+uint32_t latency_section_start;
+void* latency_section_site;
+
+
+/**
+ * Returns the histogram bucket of a duration.
+ * 
+ * @param cycles    The duration in clock cycles
+ * 
+ * @return          The index of the bucket
+ */
+__attribute__((section(".iram")))
+uint8_t latency_bucket(uint32_t cycles) {
+
+    uint8_t i;
+
+    for (i = 0; cycles && i < LATENCY_BUCKETS - 1; i++) {
+        cycles >>= 1;
+    }
+    return i;
+
+}
+
+/**
+ * Starts measuring the latency of the Period Interval Timer's ticks.
+ * Call right after the Period Interval Timer has been started.
+ * 
+ * @param pit_period    The period of the Period Interval Timer in slow clock cycles, must be a power
+ *                      of two
+ */
+void latency_init(uint32_t pit_period) {
+    latency_pit_mask = pit_period - 1;
+    latency_pit_phase = timer_read_real_time() & latency_pit_mask;
+}
+
+/**
+ * Records the time from the last tick of the Period Interval Timer until now.
+ */
+__attribute__((section(".iram")))
+void latency_record_tick(void) {
+
+    uint32_t cycles = (timer_read_real_time() - latency_pit_phase) & latency_pit_mask;
+
+    latency_stats.irq_hist[latency_bucket(cycles)]++;
+    if (cycles > latency_stats.irq_max) {
+        latency_stats.irq_max = cycles;
+    }
+
+}
+
+/**
+ * Marks the start of an IRQ-disabled section.
+ * Sections do not nest, a section that is started while another one is running is part of it.
+ * 
+ * @param site      The address the section is started from
+ */
+__attribute__((section(".iram")))
+void latency_section_begin(void* site) {
+
+    if (latency_section_site) {
+        return;
+    }
+
+    latency_section_start = timer_read_real_time();
+    latency_section_site = site;
+
+}
+
+/**
+ * Marks the end of the current IRQ-disabled section and records its duration.
+ */
+__attribute__((section(".iram")))
+void latency_section_end(void) {
+
+    uint32_t cycles;
+    uint32_t site = (uint32_t) latency_section_site;
+    struct latency_site* entry;
+    struct latency_site* shortest;
+    uint8_t i;
+
+    if (!site) {
+        return;
+    }
+    latency_section_site = 0;
+
+    cycles = (timer_read_real_time() - latency_section_start) & (TIMER_CLOCK_WRAP - 1);
+    latency_stats.off_hist[latency_bucket(cycles)]++;
+    if (cycles > latency_stats.off_max) {
+        latency_stats.off_max = cycles;
+    }
+
+    // Update the site's entry, or replace the site with the shortest section if this one is longer
+    shortest = &latency_stats.sites[0];
+    for (i = 0; i < LATENCY_SITES; i++) {
+        entry = &latency_stats.sites[i];
+        if (entry->site == site || !entry->site) {
+            break;
+        }
+        if (entry->max < shortest->max) {
+            shortest = entry;
+        }
+    }
+
+    if (i == LATENCY_SITES) {
+        if (cycles <= shortest->max) {
+            return;
+        }
+        entry = shortest;
+        entry->site = site;
+        entry->count = 0;
+        entry->max = 0;
+    } else if (!entry->site) {
+        entry->site = site;
+    }
+
+    entry->count++;
+    if (cycles > entry->max) {
+        entry->max = cycles;
+    }
+
+}
+
+/**
+ * Copies the statistics.
+ * 
+ * @param report    Pointer to the struct to write the statistics into
+ * @param reset     Whether the statistics should be cleared afterwards
+ */
+void latency_copy(struct latency_report* report, uint8_t reset) {
+
+    uint32_t* from = (uint32_t*) &latency_stats;
+    uint32_t* to = (uint32_t*) report;
+    uint32_t i;
+
+    for (i = 0; i < sizeof(struct latency_report) / 4; i++) {
+        to[i] = from[i];
+        if (reset) {
+            from[i] = 0;
+        }
+    }
+
+}
+
+#else
+
+void latency_init(uint32_t pit_period) {
+    UNUSED(pit_period);
+}
+
+void latency_copy(struct latency_report* report, uint8_t reset) {
+    UNUSED(reset);
+    memzero((uint8_t*) report, sizeof(struct latency_report));
+}
+
+#endif /* LATENCY_ENABLED */
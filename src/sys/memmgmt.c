@@ -7,10 +7,33 @@
 
 
 #include "sys/memmgmt.h"
+#include "drivers/cp15.h"
+#include "drivers/interrupt.h"
 #include "drivers/util.h"
 #include "lib/inttypes.h"
+#include "lib/kinfo.h"
 #include "lib/math.h"
 #include "lib/mem.h"
+#include "lib/mman.h"
+#include "sys/trace.h"
+
+
+// The number of translation table entries that map each page, pages shared after a fork have more
+// than one
+uint8_t memmgmt_page_refs[ALLOC_TABLE_ENTRIES * 32];
+
+// The sections owned by the address spaces, by the slot of their translation table base
+struct memmgmt_space memmgmt_spaces[MEMMGMT_MAX_SPACES];
+
+// Free pages the idle thread has allocated and zeroed in advance, and the one it is zeroing (0 if
+// none, page 0 is reserved) with the number of its bytes that are zeroed already
+uint16_t memmgmt_zero_pool[MEMMGMT_ZERO_POOL];
+uint8_t memmgmt_zero_pool_num;
+uint16_t memmgmt_zero_filling;
+uint32_t memmgmt_zero_filled;
+
+// Whether the translation table slots are in use, free or free and zeroed already
+uint8_t memmgmt_ttb_state[MEMMGMT_MAX_SPACES];
 
 
 /* BEGIN Translation and resolving functions */
@@ -113,13 +136,252 @@ void memmgmt_init_allocation_table(void) {
     uint32_t* alloc_table = (uint32_t*) ALLOC_TABLE;
 
     memzero((uint8_t*) alloc_table, ALLOC_TABLE_ENTRIES * 4);
-    alloc_table[0] = 0x00000003;  // reserve the first two pages in RAM (the kernel memory!)
+    alloc_table[0] = (1 << MEMMGMT_RESERVED_PAGES) - 1;  // reserve the first pages in RAM (the kernel memory!)
+
+}
+
+/**
+ * Initializes the zeroing in advance: the pool is empty and the contents of all translation table
+ * slots are unknown.
+ */
+void memmgmt_init_zero_pool(void) {
+
+    uint32_t i;
+
+    for (i = 0; i < MEMMGMT_MAX_SPACES; i++) {
+        memmgmt_ttb_state[i] = MEMMGMT_TTB_DIRTY;
+    }
+    memmgmt_zero_pool_num = 0;
+    memmgmt_zero_filling = 0;
+
+}
+
+/**
+ * Switches to a translation table base and locks the translations of the kernel's sections into
+ * the TLBs: the exception vectors, the internal RAM with the interrupt and system call entry code
+ * and the kernel's stacks, the kernel, the TCB table, the kernel information page and the
+ * peripherals. As every address space maps these the same way, the entries stay valid across
+ * thread switches and survive the TLB invalidation of every address space switch.
+ * 
+ * @param ttb       A pointer to the translation table base to switch to
+ */
+void memmgmt_init_lockdown(uint32_t* ttb) {
+
+    cp15_write_translation_table_base(ttb);
+    cp15_mmu_enable();
+    cp15_invalidate_tlb();
+
+    cp15_lock_dtlb_entry(BOOT_MEM);
+    cp15_lock_dtlb_entry(INT_RAM);
+    cp15_lock_dtlb_entry(EXT_RAM);
+    cp15_lock_dtlb_entry(EXT_RAM + 1*MB);
+    cp15_lock_dtlb_entry(KINFO_ADDR);
+    cp15_lock_dtlb_entry(MEMMGMT_PERIPHERALS);
+
+    cp15_lock_itlb_entry(BOOT_MEM);
+    cp15_lock_itlb_entry(INT_RAM);
+    cp15_lock_itlb_entry(EXT_RAM);
+    cp15_lock_itlb_entry(EXT_RAM + 1*MB);
 
 }
 
 /* END Initialization functions */
 
 
+/* BEGIN Address space bookkeeping functions */
+
+/**
+ * Returns the bookkeeping of the sections an address space owns.
+ * 
+ * @param ttb       A pointer to the address space's translation table base
+ * 
+ * @return          A pointer to the address space's owned sections
+ */
+struct memmgmt_space* memmgmt_get_space(uint32_t* ttb) {
+    return &memmgmt_spaces[((uint32_t) ttb - TTB_FIRST_ADDR) >> 14];
+}
+
+/**
+ * Records that an address space owns the section of a translation table entry.
+ * 
+ * @param ttb       A pointer to the address space's translation table base
+ * @param index     The index of the translation table entry
+ */
+void memmgmt_own(uint32_t* ttb, uint32_t index) {
+
+    struct memmgmt_space* space = memmgmt_get_space(ttb);
+
+    if (space->sections[index >> 5] & 1 << (index & 0x1F)) {
+        return;
+    }
+    space->sections[index >> 5] |= 1 << (index & 0x1F);
+    space->summary[index >> 10] |= 1 << ((index >> 5) & 0x1F);
+    space->owned++;
+
+}
+
+/**
+ * Records that an address space no longer owns the section of a translation table entry.
+ * 
+ * @param ttb       A pointer to the address space's translation table base
+ * @param index     The index of the translation table entry
+ */
+void memmgmt_disown(uint32_t* ttb, uint32_t index) {
+
+    struct memmgmt_space* space = memmgmt_get_space(ttb);
+
+    if (!(space->sections[index >> 5] & 1 << (index & 0x1F))) {
+        return;
+    }
+    space->owned--;
+    space->sections[index >> 5] &= ~(1 << (index & 0x1F));
+    if (!space->sections[index >> 5]) {
+        space->summary[index >> 10] &= ~(1 << ((index >> 5) & 0x1F));
+    }
+
+}
+
+/**
+ * Finds the next section an address space owns. Skips 32 words of the bitmap at once where the
+ * summary says they are empty, so walking all owned sections costs little more than their number.
+ * 
+ * @param space     A pointer to the address space's owned sections
+ * @param index     The index of the translation table entry to start looking at
+ * 
+ * @return          The index of the next owned section's entry, or -1 if there is none
+ */
+int32_t memmgmt_next_owned(struct memmgmt_space* space, uint32_t index) {
+
+    uint32_t word = index >> 5;
+    uint32_t bits;
+
+    while (word < MEMMGMT_TTB_ENTRIES / 32) {
+        if (!space->summary[word >> 5]) {
+            // None of the words this summary word stands for has a bit set
+            word = (word | 0x1F) + 1;
+        } else if (space->summary[word >> 5] & 1 << (word & 0x1F)) {
+            for (bits = space->sections[word] >> (index & 0x1F); bits; bits >>= 1, index++) {
+                if (bits & 1) {
+                    return index;
+                }
+            }
+            word++;
+        } else {
+            word++;
+        }
+        index = word << 5;
+    }
+
+    return -1;
+
+}
+
+/* END Address space bookkeeping functions */
+
+
+/* BEGIN Accounting functions */
+
+/**
+ * Returns whether an address space may own a number of sections more without exceeding its limit.
+ * 
+ * @param ttb       A pointer to the address space's translation table base
+ * @param num       The number of sections to add
+ * 
+ * @return          1 iff the sections are within the limit, 0 otherwise
+ */
+uint8_t memmgmt_within_limit(uint32_t* ttb, uint32_t num) {
+
+    struct memmgmt_space* space = memmgmt_get_space(ttb);
+
+    return !space->limit || (num <= space->limit && space->owned <= space->limit - num);
+
+}
+
+/**
+ * Sets the most sections an address space may own. Sections it owns already are kept, only new
+ * mappings and reservations are refused. A limit can only be lowered, never raised or removed.
+ * 
+ * @param ttb       A pointer to the address space's translation table base
+ * @param sections  The new limit, 0 for none
+ * 
+ * @return          1 iff the limit was set, 0 otherwise
+ */
+uint8_t memmgmt_set_limit(uint32_t* ttb, uint32_t sections) {
+
+    struct memmgmt_space* space = memmgmt_get_space(ttb);
+
+    if (space->limit && (!sections || sections > space->limit)) {
+        return 0;
+    }
+    space->limit = sections;
+
+    return 1;
+
+}
+
+/**
+ * Counts the free pages, including the ones zeroed in advance that nobody uses yet.
+ * 
+ * @return          The number of free pages
+ */
+uint32_t memmgmt_count_free_pages(void) {
+
+    uint32_t* alloc_table = (uint32_t*) ALLOC_TABLE;
+    uint32_t num = memmgmt_zero_pool_num;
+    uint32_t entry;
+    uint32_t i;
+
+    if (memmgmt_zero_filling) {
+        num++;
+    }
+
+    for (i = 0; i < ALLOC_TABLE_ENTRIES; i++) {
+        for (entry = ~alloc_table[i]; entry; entry &= entry - 1) {
+            num++;
+        }
+    }
+
+    return num;
+
+}
+
+/**
+ * Collects the memory usage of an address space from the sections it owns.
+ * 
+ * @param ttb       A pointer to the address space's translation table base
+ * @param stats     A pointer to the struct to write the usage into
+ */
+void memmgmt_get_stats(uint32_t* ttb, struct mem_stats* stats) {
+
+    struct memmgmt_space* space = memmgmt_get_space(ttb);
+    int32_t i;
+    int32_t page;
+
+    stats->resident = 0;
+    stats->shared = 0;
+    stats->reserved = 0;
+
+    for (i = memmgmt_next_owned(space, 0); i != -1; i = memmgmt_next_owned(space, i + 1)) {
+        if ((ttb[i] & 0x03) != 0x02) {
+            stats->reserved++;
+            continue;
+        }
+        stats->resident++;
+        page = memmgmt_address_to_page((void*) (ttb[i] & 0xFFF00000));
+        if (page >= MEMMGMT_RESERVED_PAGES && memmgmt_page_refs[page] > 1) {
+            stats->shared++;
+        }
+    }
+
+    stats->limit = space->limit;
+    stats->kernel = MEMMGMT_TTB_ENTRIES * 4 + sizeof(struct memmgmt_space);
+    stats->free = memmgmt_count_free_pages();
+
+}
+
+/* END Accounting functions */
+
+
 /* BEGIN Freeing functions */
 
 /**
@@ -155,7 +417,8 @@ int32_t memmgmt_find_free_page(void) {
 }
 
 /**
- * Frees the page with the given index.
+ * Frees the page with the given index. A page that is still shared with other translation tables
+ * only loses one reference.
  * 
  * @param page      The index of the page to free
  * 
@@ -163,8 +426,8 @@ int32_t memmgmt_find_free_page(void) {
  */
 uint8_t memmgmt_free_page(uint16_t page) {
 
-    if (page <= 1 || page >= ALLOC_TABLE_ENTRIES) {
-        // prevent freeing of the first two entries or entries behind the table
+    if (page < MEMMGMT_RESERVED_PAGES || page >= ALLOC_TABLE_ENTRIES * 32) {
+        // prevent freeing of the reserved pages or pages behind the table
         return 0;
     }
 
@@ -174,8 +437,15 @@ uint8_t memmgmt_free_page(uint16_t page) {
     uint32_t entry = alloc_table[idx];
     uint32_t b = 1 << bit;
 
-    if ((entry & b) == 1) {
+    if (memmgmt_page_refs[page] > 1) {
+        memmgmt_page_refs[page]--;
+        return 1;
+    }
+
+    if (entry & b) {
         alloc_table[idx] &= ~b;
+        memmgmt_page_refs[page] = 0;
+        trace(TRACE_PAGE_FREE, page, 0);
         return 1;
     }
     return 0; // ERROR: page not allocated
@@ -236,6 +506,8 @@ uint8_t memmgmt_allocate_page(uint16_t page) {
 
     if ((entry & b) == 0) {
         alloc_table[idx] |= b;
+        memmgmt_page_refs[page] = 1;
+        trace(TRACE_PAGE_ALLOC, page, 0);
         return 1;
     }
     return 0; // ERROR: page not free
@@ -376,14 +648,48 @@ uint8_t memmgmt_map_any(uint32_t* ttb, uint32_t from, uint8_t read, uint8_t writ
     if (ttb[table_entry]) {
         return 0;  // this entry is already occupied
     }
+    if (!memmgmt_within_limit(ttb, 1)) {
+        return 0;
+    }
 
-    int32_t page = memmgmt_find_free_page();
+    int32_t page = memmgmt_allocate_zeroed_page();
     if (page == -1) {
         return 0;
     }
-    memmgmt_allocate_page((uint16_t)page);
 
     memmgmt_map_page(ttb, math_div(from, PAGE_SIZE), (uint32_t) memmgmt_page_to_address(page), read, write);
+    memmgmt_own(ttb, table_entry);
+    trace(TRACE_MAP, from, page);
+
+    return 1;
+
+}
+
+/**
+ * Reserves a section for a virtual address inside a given translation table base without mapping
+ * any physical page yet. The reservation is kept in the (faulting) descriptor itself, the first
+ * access to the section maps a zeroed page to it.
+ * 
+ * @param ttb       A pointer to the translation table base to write the reservation into
+ * @param from      The virtual address
+ * @param read      Whether read permissions are requested
+ * @param write     Whether write permissions are requested
+ * 
+ * @return          1 iff the section was reserved, 0 otherwise
+ */
+uint8_t memmgmt_reserve(uint32_t* ttb, uint32_t from, uint8_t read, uint8_t write) {
+
+    uint32_t table_entry = from >> 20;
+    if (ttb[table_entry]) {
+        return 0;  // this entry is already occupied
+    }
+    if (!memmgmt_within_limit(ttb, 1)) {
+        return 0;
+    }
+
+    // A section descriptor without address and type bits, which is never 0
+    ttb[table_entry] = memmgmt_section_descriptor(0, read, write) & ~0x03;
+    memmgmt_own(ttb, table_entry);
 
     return 1;
 
@@ -408,10 +714,692 @@ void memmgmt_unmap_page(uint32_t* ttb, uint32_t page_num) {
 /* END Mapping functions */
 
 
+/* BEGIN Range mapping functions */
+
+/**
+ * Returns whether a range lies within the part of the address space that user mappings may be
+ * placed in.
+ * 
+ * @param address   The first address of the range
+ * @param length    The length of the range in bytes
+ * 
+ * @return          1 iff the range is not empty and within the mapping area, 0 otherwise
+ */
+uint8_t memmgmt_range_valid(uint32_t address, uint32_t length) {
+
+    uint32_t last = address + length - 1;
+
+    if (!length || last < address) {
+        return 0;
+    }
+
+    return address >= MEMMGMT_MMAP_START && last < MEMMGMT_MMAP_END;
+
+}
+
+/**
+ * Finds a range of free sections in the user mapping area inside a given translation table base,
+ * first looking at and above a hint, then from the start of the area.
+ * 
+ * @param ttb       A pointer to the translation table base to search
+ * @param hint      The index of the section to start looking at
+ * @param num       The number of contiguous free sections needed
+ * 
+ * @return          The index of the first of the sections, or 0 if there are not enough
+ */
+uint32_t memmgmt_find_free_range(uint32_t* ttb, uint32_t hint, uint32_t num) {
+
+    uint32_t first = MEMMGMT_MMAP_START >> 20;
+    uint32_t end = MEMMGMT_MMAP_END >> 20;
+    uint32_t start;
+    uint32_t found;
+    uint32_t i;
+
+    if (hint < first || hint >= end) {
+        hint = first;
+    }
+
+    for (start = hint; ; start = first) {
+        found = 0;
+        for (i = start; i < end; i++) {
+            found = ttb[i] ? 0 : found + 1;
+            if (found == num) {
+                return i - num + 1;
+            }
+        }
+        if (start == first) {
+            return 0;
+        }
+    }
+
+}
+
+/**
+ * Maps a range of memory inside a given translation table base. The sections are only reserved,
+ * their pages are mapped on the first access.
+ * 
+ * @param ttb       A pointer to the translation table base to write the mapping into
+ * @param address   With MAP_FIXED the address to map at, otherwise where to start looking for
+ *                  free sections
+ * @param length    The length of the range in bytes
+ * @param prot      The protection bits (PROT_*)
+ * @param flags     The flags (MAP_*)
+ * 
+ * @return          `address` with MAP_FIXED, the first address of the mapping otherwise, or 0 if
+ *                  the range is invalid, already (partly) mapped or beyond the address space's
+ *                  limit
+ */
+uint32_t memmgmt_map_range(uint32_t* ttb, uint32_t address, uint32_t length, uint32_t prot, uint32_t flags) {
+
+    uint32_t num = (((address & 0x000FFFFF) + length - 1) >> 20) + 1;
+    uint32_t first = address >> 20;
+    uint8_t read = (prot & (PROT_READ | PROT_WRITE | PROT_EXEC)) != 0;
+    uint8_t write = (prot & PROT_WRITE) != 0;
+    uint32_t i;
+
+    if (!length || length > MEMMGMT_MMAP_END - MEMMGMT_MMAP_START) {
+        return 0;
+    }
+
+    if (flags & MAP_FIXED) {
+        if (!memmgmt_range_valid(address, length)) {
+            return 0;
+        }
+        for (i = first; i < first + num; i++) {
+            if (ttb[i]) {
+                return 0;  // a fixed mapping never replaces another one
+            }
+        }
+    } else {
+        first = memmgmt_find_free_range(ttb, first, num);
+        if (!first) {
+            return 0;
+        }
+        address = first << 20;
+    }
+
+    if (!memmgmt_within_limit(ttb, num)) {
+        return 0;
+    }
+    for (i = first; i < first + num; i++) {
+        memmgmt_reserve(ttb, i << 20, read, write);
+    }
+
+    return address;
+
+}
+
+/**
+ * Unmaps all sections a range of memory touches inside a given translation table base and frees
+ * their pages. Sections that are not mapped are skipped.
+ * 
+ * @param ttb       A pointer to the translation table base to remove the mapping from
+ * @param address   The first address of the range
+ * @param length    The length of the range in bytes
+ * 
+ * @return          1 iff the range is within the user mapping area, 0 otherwise
+ */
+uint8_t memmgmt_unmap_range(uint32_t* ttb, uint32_t address, uint32_t length) {
+
+    uint32_t last = (address + length - 1) >> 20;
+    uint32_t entry;
+    int32_t page;
+    uint32_t i;
+
+    if (!memmgmt_range_valid(address, length)) {
+        return 0;
+    }
+
+    for (i = address >> 20; i <= last; i++) {
+        entry = ttb[i];
+        if ((entry & 0x03) != 0x02) {
+            // A reservation has no page and is never held in the TLB
+            ttb[i] = 0;
+            memmgmt_disown(ttb, i);
+            continue;
+        }
+
+        // Write back what is cached under the section's addresses while they still translate
+        cp15_clean_invalidate_dcache_range(i << 20, PAGE_SIZE);
+
+        page = memmgmt_address_to_page((void*) (entry & 0xFFF00000));
+        if (page >= MEMMGMT_RESERVED_PAGES) {
+            memmgmt_free_page(page);
+        }
+        memmgmt_unmap_page(ttb, i);
+        memmgmt_disown(ttb, i);
+        cp15_invalidate_tlb_entry(i << 20);
+    }
+
+    return 1;
+
+}
+
+/**
+ * Changes the protection of all sections a range of memory touches inside a given translation
+ * table base. Pages that are shared with other address spaces become copy-on-write sections if
+ * they are made writable.
+ * 
+ * @param ttb       A pointer to the translation table base the range is mapped in
+ * @param address   The first address of the range
+ * @param length    The length of the range in bytes
+ * @param prot      The new protection bits (PROT_*)
+ * 
+ * @return          1 iff the protection was changed, 0 if the range is invalid or not entirely
+ *                  mapped
+ */
+uint8_t memmgmt_protect_range(uint32_t* ttb, uint32_t address, uint32_t length, uint32_t prot) {
+
+    uint32_t last = (address + length - 1) >> 20;
+    uint8_t read = (prot & (PROT_READ | PROT_WRITE | PROT_EXEC)) != 0;
+    uint8_t write = (prot & PROT_WRITE) != 0;
+    uint32_t perm = memmgmt_section_descriptor(0, read, write) & 0x00000C00;
+    uint32_t entry;
+    int32_t page;
+    uint32_t i;
+
+    if (!memmgmt_range_valid(address, length)) {
+        return 0;
+    }
+    for (i = address >> 20; i <= last; i++) {
+        if (!ttb[i]) {
+            return 0;
+        }
+    }
+
+    for (i = address >> 20; i <= last; i++) {
+        // Clear the permission and domain bits
+        entry = (ttb[i] & ~0x00000DE0) | perm;
+
+        if ((entry & 0x03) == 0x02) {
+            page = memmgmt_address_to_page((void*) (entry & 0xFFF00000));
+            if (write && page >= MEMMGMT_RESERVED_PAGES && memmgmt_page_refs[page] > 1) {
+                entry = (entry & ~0x00000C00) | MEMMGMT_DOMAIN_COW << 5 | 2 << 10;
+            }
+            ttb[i] = entry;
+            cp15_invalidate_tlb_entry(i << 20);
+        } else {
+            ttb[i] = entry;
+        }
+    }
+
+    return 1;
+
+}
+
+/* END Range mapping functions */
+
+
+/* BEGIN Page contents functions */
+
+/**
+ * Copies the contents of a page into another one. Both are mapped supervisor-only at the scratch
+ * sections of the current translation table base while copying.
+ * 
+ * @param dst       The index of the page to copy to
+ * @param src       The index of the page to copy from
+ */
+void memmgmt_copy_page(uint16_t dst, uint16_t src) {
+
+    uint32_t* ttb = cp15_read_translation_table_base();
+    uint32_t from = MEMMGMT_SCRATCH_SRC;
+    uint32_t to = MEMMGMT_SCRATCH_DST;
+    uint32_t end = MEMMGMT_SCRATCH_SRC + PAGE_SIZE;
+
+    // The caches are indexed by virtual addresses, write back what was written to the source
+    // under the addresses it is mapped at in the address spaces. These are not known here, so the
+    // whole cache is cleaned. A range helper would do the same, it cleans the whole cache for
+    // ranges of the cache size and up. The kernel does not enable the caches yet, so this only
+    // keeps the copy correct for when it does.
+    cp15_clean_invalidate_dcache();
+
+    memmgmt_map_page(ttb, MEMMGMT_SCRATCH_SRC >> 20, (uint32_t) memmgmt_page_to_address(src), 0, 0);
+    memmgmt_map_page(ttb, MEMMGMT_SCRATCH_DST >> 20, (uint32_t) memmgmt_page_to_address(dst), 0, 0);
+    cp15_invalidate_tlb_entry(MEMMGMT_SCRATCH_SRC);
+    cp15_invalidate_tlb_entry(MEMMGMT_SCRATCH_DST);
+
+    // Eight words per iteration, a byte-wise copy of a whole section takes several times as long
+    asm volatile (
+        "1: \n"
+        "ldmia %[from]!, {r3-r10} \n"
+        "stmia %[to]!, {r3-r10} \n"
+        "cmp %[from], %[end] \n"
+        "blo 1b \n"
+        : [from] "+r" (from), [to] "+r" (to)
+        : [end] "r" (end)
+        : "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory"
+    );
+
+    // Drop the lines of both scratch sections before they map other pages, the sections are
+    // adjacent. Then restore the identity mapping of the scratch sections.
+    cp15_clean_invalidate_dcache_range(MEMMGMT_SCRATCH_SRC, 2 * PAGE_SIZE);
+    memmgmt_map_page(ttb, MEMMGMT_SCRATCH_SRC >> 20, MEMMGMT_SCRATCH_SRC, 0, 0);
+    memmgmt_map_page(ttb, MEMMGMT_SCRATCH_DST >> 20, MEMMGMT_SCRATCH_DST, 0, 0);
+    cp15_invalidate_tlb_entry(MEMMGMT_SCRATCH_SRC);
+    cp15_invalidate_tlb_entry(MEMMGMT_SCRATCH_DST);
+
+}
+
+/**
+ * Fills a block of memory with zeros, eight words at a time.
+ * 
+ * @param to        The first address of the block, word-aligned
+ * @param size      The size of the block in bytes, a multiple of 32
+ */
+void memmgmt_zero_words(uint32_t* to, uint32_t size) {
+
+    uint32_t* end = to + (size >> 2);
+
+    asm volatile (
+        "mov r3, #0 \n"
+        "mov r4, #0 \n"
+        "mov r5, #0 \n"
+        "mov r6, #0 \n"
+        "mov r7, #0 \n"
+        "mov r8, #0 \n"
+        "mov r9, #0 \n"
+        "mov r10, #0 \n"
+        "1: \n"
+        "stmia %[to]!, {r3-r10} \n"
+        "cmp %[to], %[end] \n"
+        "blo 1b \n"
+        : [to] "+r" (to)
+        : [end] "r" (end)
+        : "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory"
+    );
+
+}
+
+/**
+ * Fills a part of a page with zeros. The page is mapped supervisor-only at a scratch section of the
+ * current translation table base meanwhile.
+ * 
+ * @param page      The index of the page to zero
+ * @param offset    The offset of the part inside the page, a multiple of 32
+ * @param size      The size of the part in bytes, a multiple of 32
+ */
+void memmgmt_zero_page_range(uint16_t page, uint32_t offset, uint32_t size) {
+
+    uint32_t* ttb = cp15_read_translation_table_base();
+
+    memmgmt_map_page(ttb, MEMMGMT_SCRATCH_DST >> 20, (uint32_t) memmgmt_page_to_address(page), 0, 0);
+    cp15_invalidate_tlb_entry(MEMMGMT_SCRATCH_DST);
+
+    memmgmt_zero_words((uint32_t*) (MEMMGMT_SCRATCH_DST + offset), size);
+
+    // Restore the identity mapping of the scratch section
+    cp15_clean_invalidate_dcache_range(MEMMGMT_SCRATCH_DST + offset, size);
+    memmgmt_map_page(ttb, MEMMGMT_SCRATCH_DST >> 20, MEMMGMT_SCRATCH_DST, 0, 0);
+    cp15_invalidate_tlb_entry(MEMMGMT_SCRATCH_DST);
+
+}
+
+/**
+ * Fills a page with zeros. It is mapped supervisor-only at a scratch section of the current
+ * translation table base meanwhile.
+ * 
+ * @param page      The index of the page to zero
+ */
+void memmgmt_zero_page(uint16_t page) {
+    memmgmt_zero_page_range(page, 0, PAGE_SIZE);
+}
+
+/* END Page contents functions */
+
+
+/* BEGIN Zeroed page pool functions */
+
+/**
+ * Allocates a zeroed page. It comes from the pool the idle thread zeroes in advance, only if the
+ * pool is empty it is zeroed right away. The page is allocated before it is zeroed with IRQs
+ * enabled, so that no IRQ waits for the whole page.
+ * 
+ * @return          The index of the allocated page, or -1 if there is no free page
+ */
+int32_t memmgmt_allocate_zeroed_page(void) {
+
+    int32_t page;
+    uint32_t cpsr;
+
+    if (memmgmt_zero_pool_num) {
+        return memmgmt_zero_pool[--memmgmt_zero_pool_num];
+    }
+
+    page = memmgmt_find_free_page();
+    if (page != -1) {
+        memmgmt_allocate_page((uint16_t) page);
+        cpsr = interrupt_enable_irq_nested();
+        memmgmt_zero_page((uint16_t) page);
+        interrupt_restore_irq_nested(cpsr);
+        return page;
+    }
+
+    // The last page left is the one the idle thread has begun to zero, finish it
+    if (!memmgmt_zero_filling) {
+        return -1;
+    }
+    page = memmgmt_zero_filling;
+    memmgmt_zero_filling = 0;
+    cpsr = interrupt_enable_irq_nested();
+    memmgmt_zero_page_range((uint16_t) page, memmgmt_zero_filled, PAGE_SIZE - memmgmt_zero_filled);
+    interrupt_restore_irq_nested(cpsr);
+
+    return page;
+
+}
+
+/**
+ * Allocates a page whose contents are going to be overwritten anyway. The pages zeroed in advance
+ * are only used if no other page is free.
+ * 
+ * @return          The index of the allocated page, or -1 if there is no free page
+ */
+int32_t memmgmt_allocate_any_page(void) {
+
+    int32_t page = memmgmt_find_free_page();
+
+    if (page == -1) {
+        return memmgmt_allocate_zeroed_page();
+    }
+    memmgmt_allocate_page((uint16_t) page);
+
+    return page;
+
+}
+
+/**
+ * Zeroes the next bit of memory in advance: a free translation table slot that is not zeroed yet,
+ * or else the next chunk of a page for the pool. Every call takes about as long as zeroing one
+ * chunk, so the idle time can be given back to a thread that becomes ready after each of them.
+ * 
+ * @return          1 iff something was zeroed, 0 if there was nothing left to zero
+ */
+uint8_t memmgmt_refill_zero_pool(void) {
+
+    uint32_t i;
+    int32_t page;
+
+    for (i = 0; i < MEMMGMT_MAX_SPACES; i++) {
+        if (memmgmt_ttb_state[i] == MEMMGMT_TTB_DIRTY) {
+            memmgmt_zero_words((uint32_t*) (TTB_FIRST_ADDR + i * 16*KB), MEMMGMT_TTB_ENTRIES * 4);
+            memmgmt_ttb_state[i] = MEMMGMT_TTB_ZEROED;
+            return 1;
+        }
+    }
+
+    if (!memmgmt_zero_filling) {
+        if (memmgmt_zero_pool_num == MEMMGMT_ZERO_POOL) {
+            return 0;
+        }
+        page = memmgmt_find_free_page();
+        if (page == -1) {
+            return 0;
+        }
+        memmgmt_allocate_page((uint16_t) page);
+        memmgmt_zero_filling = (uint16_t) page;
+        memmgmt_zero_filled = 0;
+    }
+
+    memmgmt_zero_page_range(memmgmt_zero_filling, memmgmt_zero_filled, MEMMGMT_ZERO_CHUNK);
+    memmgmt_zero_filled += MEMMGMT_ZERO_CHUNK;
+
+    if (memmgmt_zero_filled == PAGE_SIZE) {
+        memmgmt_zero_pool[memmgmt_zero_pool_num++] = memmgmt_zero_filling;
+        memmgmt_zero_filling = 0;
+    }
+
+    return 1;
+
+}
+
+/* END Zeroed page pool functions */
+
+
+/* BEGIN Demand paging functions */
+
+/**
+ * Maps a zeroed page to a reserved section on its first access.
+ * 
+ * @param ttb       A pointer to the translation table base the section is reserved in
+ * @param address   A virtual address inside the section
+ * 
+ * @return          1 iff the section was reserved and is mapped now, 0 otherwise
+ */
+uint8_t memmgmt_resolve_reserved(uint32_t* ttb, uint32_t address) {
+
+    uint32_t index = address >> 20;
+    uint32_t entry = ttb[index];
+    int32_t page;
+
+    if (!entry || (entry & 0x03)) {
+        return 0;
+    }
+
+    page = memmgmt_allocate_zeroed_page();
+    if (page == -1) {
+        return 0;
+    }
+
+    // Faulting descriptors are never held in the TLB, there is nothing to invalidate
+    ttb[index] = (uint32_t) memmgmt_page_to_address(page) | entry | 0x02;
+    trace(TRACE_MAP, address, page);
+
+    return 1;
+
+}
+
+/* END Demand paging functions */
+
+
+/* BEGIN Copy-on-write functions */
+
+/**
+ * Shares all pages mapped in a translation table base with another one. Sections the user can
+ * write to become read-only copy-on-write sections in both tables, the first write to one of them
+ * gives the writing address space its own copy. Reserved sections stay reserved in both.
+ * 
+ * @param parent    A pointer to the translation table base to share the pages of
+ * @param child     A pointer to the translation table base to map the pages into
+ */
+void memmgmt_fork(uint32_t* parent, uint32_t* child) {
+
+    struct memmgmt_space* space = memmgmt_get_space(parent);
+    int32_t i;
+    uint32_t entry;
+    int32_t page;
+    int32_t replaced;
+
+    // Only the parent's own sections, the ones every address space maps are already in the child
+    for (i = memmgmt_next_owned(space, 0); i != -1; i = memmgmt_next_owned(space, i + 1)) {
+
+        entry = parent[i];
+        page = -1;
+        if ((entry & 0x03) == 0x02) {
+            page = memmgmt_address_to_page((void*) (entry & 0xFFF00000));
+        }
+
+        // Drop what the child has mapped here on its own, i.e. its fresh stack
+        if (child[i] && (child[i] & 0x03) == 0x02) {
+            replaced = memmgmt_address_to_page((void*) (child[i] & 0xFFF00000));
+            if (replaced >= MEMMGMT_RESERVED_PAGES) {
+                memmgmt_free_page(replaced);
+            }
+        }
+
+        if (page >= MEMMGMT_RESERVED_PAGES) {
+            if (((entry >> 10) & 0x03) == 0x03) {
+                // Read-only for the user, tagged with the copy-on-write domain
+                entry = (entry & ~0x00000DE0) | MEMMGMT_DOMAIN_COW << 5 | 2 << 10;
+                parent[i] = entry;
+                cp15_invalidate_tlb_entry((uint32_t) i << 20);
+            }
+            memmgmt_page_refs[page]++;
+        }
+        // Reservations are copied as they are, both address spaces populate them on their own
+        child[i] = entry;
+        memmgmt_own(child, i);
+
+    }
+
+}
+
+/**
+ * Gives a translation table base its own writable copy of a copy-on-write section. The last
+ * address space that references a page gets write access to it without copying.
+ * 
+ * @param ttb       A pointer to the translation table base the section is mapped in
+ * @param address   A virtual address inside the section
+ * 
+ * @return          1 iff the section was a copy-on-write section and is writable now, 0 otherwise
+ */
+uint8_t memmgmt_resolve_cow(uint32_t* ttb, uint32_t address) {
+
+    uint32_t index = address >> 20;
+    uint32_t entry = ttb[index];
+    int32_t page;
+    int32_t copy;
+
+    if ((entry & 0x03) != 0x02 || ((entry >> 5) & 0x0F) != MEMMGMT_DOMAIN_COW) {
+        return 0;
+    }
+
+    page = memmgmt_address_to_page((void*) (entry & 0xFFF00000));
+    if (page < MEMMGMT_RESERVED_PAGES) {
+        return 0;
+    }
+
+    copy = page;
+    if (memmgmt_page_refs[page] > 1) {
+        copy = memmgmt_allocate_any_page();
+        if (copy == -1) {
+            return 0;
+        }
+        memmgmt_copy_page((uint16_t) copy, (uint16_t) page);
+        memmgmt_page_refs[page]--;
+    }
+
+    ttb[index] = memmgmt_section_descriptor((uint32_t) memmgmt_page_to_address(copy), 1, 1);
+    cp15_invalidate_tlb_entry(index << 20);
+    trace(TRACE_COW, address, copy);
+
+    return 1;
+
+}
+
+/**
+ * Populates all reserved sections in a range of user memory the kernel is about to access, and
+ * resolves its copy-on-write sections if it is going to write. A fault in the kernel would not be
+ * resolved, and the kernel's own accesses are not checked against the user permissions and would
+ * otherwise write into pages that are still shared.
+ * 
+ * @param ttb       A pointer to the translation table base the range is mapped in
+ * @param address   The first address of the range
+ * @param size      The size of the range in bytes
+ * @param write     Whether the kernel is going to write to the range
+ */
+void memmgmt_prepare_access(uint32_t* ttb, uint32_t address, uint32_t size, uint8_t write) {
+
+    uint32_t last = address + size - 1;
+
+    if (!size || last < address) {
+        return;
+    }
+
+    for (address &= 0xFFF00000; address <= (last & 0xFFF00000); address += PAGE_SIZE) {
+        memmgmt_resolve_reserved(ttb, address);
+        if (write) {
+            memmgmt_resolve_cow(ttb, address);
+        }
+        if (address == 0xFFF00000) {
+            break;
+        }
+    }
+
+}
+
+/**
+ * Returns whether a range lies in user memory that the user may read, i.e. whether every section
+ * it touches is mapped with user read access. This includes the read-only sections of the
+ * libraries and kernel info below MEMMGMT_MMAP_START. Reserved sections do not count before
+ * memmgmt_prepare_access() has resolved them. The kernel must check a buffer it got from the user
+ * with this before reading from it, as its own accesses are not checked against the user
+ * permissions.
+ * 
+ * @param ttb       A pointer to the translation table base the range is mapped in
+ * @param address   The first address of the range
+ * @param size      The size of the range in bytes
+ * 
+ * @return          1 iff the range is empty or the user may read all of it, 0 otherwise
+ */
+uint8_t memmgmt_user_readable(uint32_t* ttb, uint32_t address, uint32_t size) {
+
+    uint32_t last = address + size - 1;
+    uint32_t entry;
+
+    if (!size) {
+        return 1;
+    }
+    if (last < address || last >= MEMMGMT_USER_END) {
+        return 0;
+    }
+
+    for (address &= 0xFFF00000; address <= (last & 0xFFF00000); address += PAGE_SIZE) {
+        entry = ttb[address >> 20];
+        // A section descriptor with AP 2 or 3 lets the user read
+        if ((entry & 0x03) != 0x02 || ((entry >> 10) & 0x03) < 0x02) {
+            return 0;
+        }
+    }
+
+    return 1;
+
+}
+
+/**
+ * Returns whether a range lies in user memory that the user may write to, i.e. whether every
+ * section it touches is mapped with user read/write access. Reserved and copy-on-write sections
+ * do not count before memmgmt_prepare_access() has resolved them. The kernel must check a buffer
+ * it got from the user with this before writing to it, as its own accesses are not checked against
+ * the user permissions.
+ * 
+ * @param ttb       A pointer to the translation table base the range is mapped in
+ * @param address   The first address of the range
+ * @param size      The size of the range in bytes
+ * 
+ * @return          1 iff the range is empty or the user may write to all of it, 0 otherwise
+ */
+uint8_t memmgmt_user_writable(uint32_t* ttb, uint32_t address, uint32_t size) {
+
+    uint32_t last = address + size - 1;
+    uint32_t entry;
+
+    if (!size) {
+        return 1;
+    }
+    if (last < address || address < MEMMGMT_MMAP_START || last >= MEMMGMT_USER_END) {
+        return 0;
+    }
+
+    for (address &= 0xFFF00000; address <= (last & 0xFFF00000); address += PAGE_SIZE) {
+        entry = ttb[address >> 20];
+        // Only a section descriptor with AP 3 lets the user write
+        if ((entry & 0x03) != 0x02 || ((entry >> 10) & 0x03) != 0x03) {
+            return 0;
+        }
+    }
+
+    return 1;
+
+}
+
+/* END Copy-on-write functions */
+
+
 /* BEGIN Thread management functions */
 
 /**
- * Sets up a thread by allocating a page for its translation table base.
+ * Sets up a thread by allocating a page for its translation table base. The table only needs to be
+ * cleared if the idle thread has not zeroed its slot in advance.
  * 
  * @param id        The thread's ID
  * 
@@ -420,43 +1408,51 @@ void memmgmt_unmap_page(uint32_t* ttb, uint32_t page_num) {
 uint32_t* memmgmt_setup_thread(uint32_t id) {
 
     uint32_t* ttb_addr = (uint32_t*)(TTB_FIRST_ADDR + (id-1) * 16*KB);
-    memzero((uint8_t*) ttb_addr, MEMMGMT_TTB_ENTRIES * 4);
+
+    if (memmgmt_ttb_state[id-1] != MEMMGMT_TTB_ZEROED) {
+        memmgmt_zero_words(ttb_addr, MEMMGMT_TTB_ENTRIES * 4);
+    }
+    memmgmt_ttb_state[id-1] = MEMMGMT_TTB_USED;
+    memzero((uint8_t*) memmgmt_get_space(ttb_addr), sizeof(struct memmgmt_space));
 
     return ttb_addr;
 
 }
 
 /**
- * Cleans up a thread by freeing all its pages.
+ * Cleans up a thread by freeing all its pages. Only the sections the address space owns are
+ * visited.
  * 
  * @param ttb_addr      A pointer to the first address of the translation table base
  */
 void memmgmt_cleanup_thread(uint32_t* ttb_addr) {
 
-    uint16_t i;
+    struct memmgmt_space* space = memmgmt_get_space(ttb_addr);
+    int32_t i;
     int32_t page;
 
-    for (i = 0; i < MEMMGMT_TTB_ENTRIES; i++) {
+    for (i = memmgmt_next_owned(space, 0); i != -1; i = memmgmt_next_owned(space, i + 1)) {
 
-        if (ttb_addr[i] == 0) {
-            // Empty entry, nothing to do
+        if ((ttb_addr[i] & 0x03) != 0x02) {
+            // A reservation that was never accessed, nothing to do
             continue;
         }
 
         // free the page the table points to
         page = memmgmt_address_to_page((void*) (ttb_addr[i] & 0xFFF00000));
 
-        if (page > 1) {               // if the page is not unallocatable and or the OS ...
+        if (page >= MEMMGMT_RESERVED_PAGES) {  // if the page is not unallocatable and or the OS ...
             memmgmt_free_page(page);  // ... free it
         }
-        // ttb_addr[i] = 0;
 
     }
+    memzero((uint8_t*) space, sizeof(struct memmgmt_space));
+    memmgmt_ttb_state[((uint32_t) ttb_addr - TTB_FIRST_ADDR) >> 14] = MEMMGMT_TTB_DIRTY;
 
     // free the page the table is on
     page = memmgmt_address_to_page((void*)((uint32_t)ttb_addr & 0xFFF00000));
 
-    if (page > 1) {
+    if (page >= MEMMGMT_RESERVED_PAGES) {
         memmgmt_free_page(page);
     }
 
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Functions for the sampling profiler driven by the Period Interval Timer.
+ */
+
+
+#include "sys/profile.h"
+#include "drivers/dbgu.h"
+#include "drivers/interrupt.h"
+#include "lib/inttypes.h"
+#include "sys/thread.h"
+
+
+#if PROFILE_ENABLED
+
+struct profile_sample profile_samples[PROFILE_SIZE];
+
+uint8_t profile_active;
+
+// Free-running indices of the sample buffer
+uint32_t profile_head;
+uint32_t profile_tail;
+
+// Number of samples dropped because the buffer was full
+uint32_t profile_lost;
+
+
+/**
+ * Discards all samples and starts sampling, or stops sampling.
+ * 
+ * @param on        1 to start, 0 to stop
+ */
+void profile_enable(uint8_t on) {
+
+    uint32_t cpsr = interrupt_disable_irq_save();
+
+    if (on) {
+        profile_head = 0;
+        profile_tail = 0;
+        profile_lost = 0;
+    }
+    profile_active = on;
+
+    interrupt_restore_irq(cpsr);
+
+}
+
+/**
+ * Stores a sample, drops it if the buffer is full.
+ * Use only in the IRQ handler!
+ * 
+ * @param pc        The address of the interrupted instruction
+ * @param psr       The PSR of the interrupted code
+ */
+__attribute__((section(".iram")))
+void profile_record(uint32_t pc, uint32_t psr) {
+
+    struct profile_sample* sample;
+
+    if (profile_head - profile_tail >= PROFILE_SIZE) {
+        profile_lost++;
+        return;
+    }
+
+    sample = &profile_samples[profile_head & (PROFILE_SIZE - 1)];
+    sample->pc = pc;
+    sample->tid = thread_get_current()->id;
+    sample->mode = psr & INTERRUPT_MODE_MASK;
+    profile_head++;
+
+}
+
+/**
+ * Moves the oldest samples out of the buffer.
+ * 
+ * @param samples   Pointer to the array to write the samples into
+ * @param max       The number of entries in the array
+ * 
+ * @return          The number of samples written
+ */
+__attribute__((section(".iram")))
+uint32_t profile_copy(struct profile_sample* samples, uint32_t max) {
+
+    uint32_t cpsr = interrupt_disable_irq_save();
+    uint32_t num = 0;
+    struct profile_sample* sample;
+
+    for (; num < max && profile_tail != profile_head; num++, profile_tail++) {
+        sample = &profile_samples[profile_tail & (PROFILE_SIZE - 1)];
+        samples[num].pc = sample->pc;
+        samples[num].tid = sample->tid;
+        samples[num].mode = sample->mode;
+    }
+
+    interrupt_restore_irq(cpsr);
+    return num;
+
+}
+
+/**
+ * Writes all samples in the buffer to the DBGU and removes them, bypassing the output buffer.
+ * The dump consists of PROFILE_MAGIC, the number of dropped samples and the number of samples that
+ * follow, then the samples, all in little endian. IRQs are disabled while it is written.
+ */
+void profile_dump(void) {
+
+    uint32_t cpsr = interrupt_disable_irq_save();
+    uint32_t header[3];
+
+    header[0] = PROFILE_MAGIC;
+    header[1] = profile_lost;
+    header[2] = profile_head - profile_tail;
+    dbgu_write_bytes((uint8_t*) header, sizeof(header));
+
+    for (; profile_tail != profile_head; profile_tail++) {
+        dbgu_write_bytes((uint8_t*) &profile_samples[profile_tail & (PROFILE_SIZE - 1)],
+                sizeof(struct profile_sample));
+    }
+
+    interrupt_restore_irq(cpsr);
+
+}
+
+#else
+
+void profile_enable(uint8_t on) {
+    UNUSED(on);
+}
+
+uint32_t profile_copy(struct profile_sample* samples, uint32_t max) {
+    UNUSED(samples);
+    UNUSED(max);
+    return 0;
+}
+
+void profile_dump(void) {
+}
+
+#endif /* PROFILE_ENABLED */
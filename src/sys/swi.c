@@ -7,11 +7,18 @@
 
 
 #include "sys/swi.h"
+#include "drivers/timer.h"
 #include "drivers/util.h"
 #include "lib/string.h"
 #include "sys/io.h"
+#include "sys/latency.h"
 #include "sys/memmgmt.h"
+#include "sys/profile.h"
 #include "sys/thread.h"
+#include "sys/trace.h"
+
+
+typedef uint8_t (*fast_func)(uint32_t*);
 
 
 /* BEGIN System call functions */
@@ -24,7 +31,15 @@ void swi_str_write(struct thread_tcb* tcb) {
     char* target = (char*)tcb->r[7];
     size_t length = (size_t)tcb->r[8];
 
-    size_t size = io_dbgu_write_output_string(target, length);
+    size_t size;
+
+    memmgmt_prepare_access(tcb->ttb, (uint32_t) target, length, 0);
+    if (!memmgmt_user_readable(tcb->ttb, (uint32_t) target, length)) {
+        tcb->r[7] = (uint32_t) -1;
+        return;
+    }
+
+    size = io_dbgu_write_output_string(target, length);
 
     // Write the output parameters
     tcb->r[7] = (uint32_t)size;
@@ -43,6 +58,12 @@ void swi_str_read(struct thread_tcb* tcb) {
         return;
     }
 
+    memmgmt_prepare_access(tcb->ttb, (uint32_t) target, length, 1);
+    if (!memmgmt_user_writable(tcb->ttb, (uint32_t) target, length)) {
+        tcb->r[7] = (uint32_t) -1;
+        return;
+    }
+
     size = io_dbgu_read_input_string(target, length);
     if (!size) {
         thread_block_for_input(tcb);
@@ -55,17 +76,13 @@ void swi_str_read(struct thread_tcb* tcb) {
 
 }
 
+__attribute__((section(".iram")))
 void swi_str_read_resume(struct thread_tcb* tcb) {
 
-    // Read the input parameters
-    char* target = (char*)tcb->r[7];
-    size_t length = (size_t)tcb->r[8];
-
-    // This call will always succeed because it's called from the interrupt handler
-    size_t size = (uint32_t)io_dbgu_read_input_string(target, length);
-
-    // Write the output parameters
-    tcb->r[7] = (uint32_t)size;
+    // The buffer belongs to the address space of the blocked thread, which is not necessarily the
+    // current one. The thread executes the system call again once it runs in its own space, r7 and
+    // r8 still hold the parameters.
+    tcb->r[THREAD_REG_PC] -= 4;
 
 }
 
@@ -79,6 +96,7 @@ void swi_getc(struct thread_tcb* tcb) {
     thread_select();
 }
 
+__attribute__((section(".iram")))
 void swi_getc_resume(struct thread_tcb* tcb, char c) {
     tcb->r[7] = c;
 }
@@ -88,8 +106,10 @@ void swi_getc_resume(struct thread_tcb* tcb, char c) {
 
 /* BEGIN Thread management system calls */
 
+__attribute__((section(".iram")))
 void swi_thread_yield(struct thread_tcb* tcb) {
-    UNUSED(tcb);
+    // The thread may be selected again if there is no other thread ready
+    tcb->status = THREAD_STATUS_READY;
     thread_select();
 }
 
@@ -105,6 +125,11 @@ void swi_thread_create(struct thread_tcb* tcb) {
 
     child = thread_create((void*)tcb->r[7], tcb->id, tcb->r[8], 0);
 
+    if (!child) {
+        tcb->r[7] = (uint32_t) -1;
+        return;
+    }
+
     // Pass starting parameters to child
     for (i = 0; i < 2; i++) {
         child->r[i] = tcb->r[9+i];
@@ -121,24 +146,186 @@ void swi_thread_sleep(struct thread_tcb* tcb) {
     thread_select();
 }
 
+void swi_thread_fork(struct thread_tcb* tcb) {
+
+    struct thread_tcb* child = thread_fork(tcb);
+
+    if (!child) {
+        tcb->r[7] = (uint32_t) -1;
+        return;
+    }
+
+    // Write the output parameters, the child sees 0
+    child->r[7] = 0;
+    tcb->r[7] = child->id;
+    thread_activate(child->id);
+
+}
+
 /* END Thread management system calls */
 
 
 /* BEGIN Memory management system calls */
 
 void swi_mem_map(struct thread_tcb* tcb) {
-    uint32_t from = tcb->r[7];
-    if (from < EXT_RAM + 5*MB) {
-        tcb->r[7] = 0;
-        return;
-    }
+    tcb->r[7] = memmgmt_map_range(tcb->ttb, tcb->r[7], tcb->r[8], tcb->r[9], tcb->r[10]);
+}
+
+void swi_mem_unmap(struct thread_tcb* tcb) {
+    tcb->r[7] = memmgmt_unmap_range(tcb->ttb, tcb->r[7], tcb->r[8]);
+}
 
-    tcb->r[7] = (uint32_t)memmgmt_map_any(tcb->ttb, tcb->r[7], 1, 1);
+void swi_mem_protect(struct thread_tcb* tcb) {
+    tcb->r[7] = memmgmt_protect_range(tcb->ttb, tcb->r[7], tcb->r[8], tcb->r[9]);
 }
 
 /* END Memory management system calls */
 
 
+/* BEGIN Debugging system calls */
+
+void swi_trace_dump(struct thread_tcb* tcb) {
+    UNUSED(tcb);
+    trace_dump();
+}
+
+/* END Debugging system calls */
+
+
+/* BEGIN Fast system call functions */
+
+__attribute__((section(".iram")))
+uint8_t swi_fast_thread_yield(uint32_t* args) {
+    UNUSED(args);
+    // Yielding is only a no-op if the current thread would be selected again
+    return !thread_others_ready();
+}
+
+__attribute__((section(".iram")))
+uint8_t swi_fast_thread_id(uint32_t* args) {
+    args[0] = thread_get_current()->id;
+    return 1;
+}
+
+__attribute__((section(".iram")))
+uint8_t swi_fast_clock_gettime(uint32_t* args) {
+
+    uint64_t ns = timer_clock_to_ns(timer_read_clock());
+
+    args[0] = (uint32_t) ns;
+    args[1] = (uint32_t) (ns >> 32);
+    return 1;
+
+}
+
+__attribute__((section(".iram")))
+uint8_t swi_fast_thread_stats(uint32_t* args) {
+
+    uint32_t* ttb = thread_get_current()->ttb;
+    // There are never more entries to write, which also keeps the size from overflowing
+    uint32_t max = args[1] < THREAD_MAX_THREADS ? args[1] : THREAD_MAX_THREADS;
+
+    memmgmt_prepare_access(ttb, args[0], max * sizeof(struct thread_stats), 1);
+    if (!memmgmt_user_writable(ttb, args[0], max * sizeof(struct thread_stats))) {
+        args[0] = (uint32_t) -1;
+        return 1;
+    }
+
+    args[0] = thread_get_stats((struct thread_stats*) args[0], max);
+    return 1;
+
+}
+
+uint8_t swi_fast_profile_enable(uint32_t* args) {
+    profile_enable(args[0] ? 1 : 0);
+    return 1;
+}
+
+__attribute__((section(".iram")))
+uint8_t swi_fast_profile_read(uint32_t* args) {
+
+    uint32_t* ttb = thread_get_current()->ttb;
+    // There are never more samples to write, which also keeps the size from overflowing
+    uint32_t max = args[1] < PROFILE_SIZE ? args[1] : PROFILE_SIZE;
+
+    memmgmt_prepare_access(ttb, args[0], max * sizeof(struct profile_sample), 1);
+    if (!memmgmt_user_writable(ttb, args[0], max * sizeof(struct profile_sample))) {
+        args[0] = (uint32_t) -1;
+        return 1;
+    }
+
+    args[0] = profile_copy((struct profile_sample*) args[0], max);
+    return 1;
+
+}
+
+uint8_t swi_fast_mem_stats(uint32_t* args) {
+
+    uint32_t* ttb = thread_get_current()->ttb;
+
+    memmgmt_prepare_access(ttb, args[0], sizeof(struct mem_stats), 1);
+    if (!memmgmt_user_writable(ttb, args[0], sizeof(struct mem_stats))) {
+        args[0] = (uint32_t) -1;
+        return 1;
+    }
+
+    memmgmt_get_stats(ttb, (struct mem_stats*) args[0]);
+    args[0] = 0;
+    return 1;
+
+}
+
+uint8_t swi_fast_mem_limit(uint32_t* args) {
+    args[0] = memmgmt_set_limit(thread_get_current()->ttb, args[0]);
+    return 1;
+}
+
+uint8_t swi_fast_latency_read(uint32_t* args) {
+
+    uint32_t* ttb = thread_get_current()->ttb;
+
+    memmgmt_prepare_access(ttb, args[0], sizeof(struct latency_report), 1);
+    if (!memmgmt_user_writable(ttb, args[0], sizeof(struct latency_report))) {
+        args[0] = (uint32_t) -1;
+        return 1;
+    }
+
+    latency_copy((struct latency_report*) args[0], args[1] ? 1 : 0);
+    args[0] = 0;
+    return 1;
+
+}
+
+/**
+ * Dispatches a system call on the fast path, i.e. without saving the thread's context.
+ * Fast system calls can only read and write their parameters in r7 and r8 and must not block or
+ * switch threads. They return 0 if the call has to be handled on the full path after all.
+ * Use only in the SWI Interrupt Service Routine!
+ * 
+ * @param num       The system call's number
+ * @param args      The saved r7 and r8 of the calling thread
+ * 
+ * @return          1 iff the system call has been handled, 0 otherwise
+ */
+__attribute__((section(".iram")))
+uint32_t swi_fast_dispatch(uint32_t num, uint32_t* args) {
+
+    uint8_t i = 0;
+
+    trace(TRACE_SWI_FAST, num, 0);
+
+    while (swi_fast_types[i++]) {
+        if (num == swi_fast_types[i-1]) {
+            return ((fast_func)swi_fast_functions[i-1])(args);
+        }
+    }
+    return 0;
+
+}
+
+/* END Fast system call functions */
+
+
 /* BEGIN System call management tables */
 
 uint32_t swi_types[] = {
@@ -150,7 +337,11 @@ uint32_t swi_types[] = {
     SWI_THREAD_EXIT,
     SWI_THREAD_CREATE,
     SWI_THREAD_SLEEP,
+    SWI_THREAD_FORK,
     SWI_MEM_MAP,
+    SWI_MEM_UNMAP,
+    SWI_MEM_PROTECT,
+    SWI_TRACE_DUMP,
     0x00
 };
 
@@ -163,7 +354,36 @@ void* swi_functions[] = {
     &swi_thread_exit,
     &swi_thread_create,
     &swi_thread_sleep,
-    &swi_mem_map
+    &swi_thread_fork,
+    &swi_mem_map,
+    &swi_mem_unmap,
+    &swi_mem_protect,
+    &swi_trace_dump
+};
+
+uint32_t swi_fast_types[] = {
+    SWI_THREAD_YIELD,
+    SWI_THREAD_ID,
+    SWI_CLOCK_GETTIME,
+    SWI_THREAD_STATS,
+    SWI_PROFILE_ENABLE,
+    SWI_PROFILE_READ,
+    SWI_LATENCY_READ,
+    SWI_MEM_STATS,
+    SWI_MEM_LIMIT,
+    0x00
+};
+
+void* swi_fast_functions[] = {
+    &swi_fast_thread_yield,
+    &swi_fast_thread_id,
+    &swi_fast_clock_gettime,
+    &swi_fast_thread_stats,
+    &swi_fast_profile_enable,
+    &swi_fast_profile_read,
+    &swi_fast_latency_read,
+    &swi_fast_mem_stats,
+    &swi_fast_mem_limit
 };
 
 /* END System call management tables */
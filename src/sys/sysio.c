@@ -24,9 +24,12 @@
 __attribute__((format(printf, 1, 2)))
 void printf_isr(const char* format, ...) {
 
-    /* Retrieve the number of arguments by parsing the format string for % chars */
     char target[512]; // This is the target buffer for our final interpolated string
-    interpolate_core(target, 512, format, &format + 1);
+    __builtin_va_list args;
+
+    __builtin_va_start(args, format);
+    interpolate_va(target, 512, format, args);
+    __builtin_va_end(args);
     target[511] = 0; // Ensure there is a 0 terminator
 
     io_dbgu_write_output_string(target, strnlen(target, 512));
@@ -8,19 +8,34 @@
 
 #include "sys/thread.h"
 #include "drivers/cp15.h"
+#include "drivers/timer.h"
 #include "drivers/util.h"
 #include "lib/buffer.h"
 #include "lib/inttypes.h"
 #include "lib/math.h"
 #include "lib/mem.h"
+#include "sys/kinfo.h"
 #include "sys/memmgmt.h"
 #include "sys/sysio.h"
+#include "sys/trace.h"
 
 
 struct thread_tcb thread_tcb_list[THREAD_MAX_THREADS];
 uint8_t thread_switch_counter;
+uint8_t thread_switch_pending;
 uint32_t thread_sched_cur_idx;
 
+// The context the Interrupt Service Routines save to and restore from, i.e. the registers of the
+// current thread's TCB. Until the first thread runs, the boot code's context is saved here.
+uint32_t thread_boot_ctx[17];
+uint32_t* thread_cur_ctx = thread_boot_ctx;
+
+// The translation table base that is currently set
+uint32_t* thread_cur_ttb;
+
+// The thread whose run time is being accounted, i.e. the one that is running
+struct thread_tcb* thread_accounted;
+
 // TODO Implement these with dynamic memory
 struct ring_buffer threads_blocked_for_input;
 uint32_t threads_blocked_for_input_raw[THREAD_MAX_THREADS];
@@ -28,7 +43,8 @@ uint32_t threads_blocked_for_input_raw[THREAD_MAX_THREADS];
 struct ring_buffer threads_blocked_for_char;
 uint32_t threads_blocked_for_char_raw[THREAD_MAX_THREADS];
 
-int32_t threads_blocked_for_timer[THREAD_MAX_THREADS];
+// The clock values until which the threads sleep, 0 if they do not
+uint64_t threads_blocked_for_timer[THREAD_MAX_THREADS];
 
 
 /* BEGIN Idle thread */
@@ -43,7 +59,7 @@ void thread_idle_text(void) {
     while(1) {
         asm volatile(
             "swi 0x20"
-            ::
+            : : : "memory"
         );
     }
 }
@@ -65,10 +81,11 @@ void thread_init_management(void) {
         thread_tcb_list[i].id = 0;
         threads_blocked_for_input_raw[i] = 0;
         threads_blocked_for_char_raw[i] = 0;
-        threads_blocked_for_timer[i] = -1;
+        threads_blocked_for_timer[i] = 0;
     }
 
     thread_switch_counter = 0;
+    thread_switch_pending = 0;
 
     ring_init(
         &threads_blocked_for_input,
@@ -92,6 +109,7 @@ void thread_init_management(void) {
  * 
  * @return          A pointer to the thread's TCB
  */
+__attribute__((section(".iram")))
 struct thread_tcb* thread_get_current(void) {
     return &thread_tcb_list[thread_sched_cur_idx];
 }
@@ -131,6 +149,11 @@ struct thread_tcb* thread_create(void* text, uint32_t par_id, int8_t is_task, ui
         return 0;
     }
 
+    // Return 0 if a task's stack would exceed the limit of its parent's address space
+    if (is_task && !memmgmt_within_limit(thread_tcb_list[par_id-1].ttb, 1)) {
+        return 0;
+    }
+
     struct thread_tcb* tcb = &thread_tcb_list[i];
     memzero((uint8_t*) tcb, sizeof(struct thread_tcb));
 
@@ -158,6 +181,45 @@ struct thread_tcb* thread_create(void* text, uint32_t par_id, int8_t is_task, ui
     tcb->status     = THREAD_STATUS_INACTIVE;
     tcb->parent_id  = par_id;
 
+    if (is_task) {
+        tcb->ttb = (uint32_t*) thread_tcb_list[par_id-1].ttb;
+        // Reserve the stack for the task, it is mapped on its first access
+        if (!memmgmt_reserve(tcb->ttb, tcb->r[THREAD_REG_SP] - 1*MB, 1, 1)) {
+            thread_tcb_list[par_id-1].num_task_children--;
+            tcb->id = 0;
+            return 0;
+        }
+    } else {
+        tcb->ttb = memmgmt_setup_thread(tcb->id);
+
+        // Setting up the mapping for the OS
+        for (i = 0; i < 512; i++) {
+            memmgmt_map_page(tcb->ttb, i, i * MB, 0, 0);
+        }
+
+        // Map the kernel non-readable to itself
+        memmgmt_map_to(tcb->ttb, 0x20000000, 0x20000000, 0, 0);
+        // Map the user library and the application read-only to itself
+        memmgmt_map_to(tcb->ttb, 0x20100000, 0x20100000, 1, 0);
+        // Map the kernel information page read-only to itself
+        memmgmt_map_to(tcb->ttb, KINFO_ADDR, KINFO_ADDR, 1, 0);
+        // A new process is held to the memory limit of the one that creates it
+        if (par_id) {
+            memmgmt_get_space(tcb->ttb)->limit = memmgmt_get_space(thread_tcb_list[par_id-1].ttb)->limit;
+        }
+        // Reserve the stack for the thread, it is mapped on its first access
+        if (!memmgmt_reserve(tcb->ttb, tcb->r[THREAD_REG_SP] - 1*MB, 1, 1)) {
+            memmgmt_cleanup_thread(tcb->ttb);
+            tcb->id = 0;
+            return 0;
+        }
+
+        // Setting up the mapping for the OS
+        for (i = MEMMGMT_TTB_ENTRIES - 256; i < MEMMGMT_TTB_ENTRIES; i++) {
+            memmgmt_map_page(tcb->ttb, i, i * MB, 0, 0);
+        }
+    }
+
     if (!is_idle) {
 
         struct thread_tcb* prev_sibling;
@@ -184,31 +246,40 @@ struct thread_tcb* thread_create(void* text, uint32_t par_id, int8_t is_task, ui
     tcb->next_sibling_id = 0;
     tcb->first_child_id = 0;
 
-    if (is_task) {
-        tcb->ttb = (uint32_t*) thread_tcb_list[par_id-1].ttb;
-        memmgmt_map_any(tcb->ttb, tcb->r[THREAD_REG_SP] - 1*MB, 1, 1);
-    } else {
-        tcb->ttb = memmgmt_setup_thread(tcb->id);
+    return tcb;
+}
 
-        // Setting up the mapping for the OS
-        for (i = 0; i < 512; i++) {
-            memmgmt_map_page(tcb->ttb, i, i * MB, 0, 0);
-        }
+/**
+ * Creates a copy of a thread in a new address space that shares all pages with the thread's one.
+ * The copy continues where the thread is, writable pages are copied on the first write.
+ * 
+ * @param parent    A pointer to the TCB of the thread to copy
+ * 
+ * @return          A pointer to the new thread's TCB, or 0 if there was an error
+ */
+struct thread_tcb* thread_fork(struct thread_tcb* parent) {
 
-        // Map the kernel non-readable to itself
-        memmgmt_map_to(tcb->ttb, 0x20000000, 0x20000000, 0, 0);
-        // Map the user library and the application read-only to itself
-        memmgmt_map_to(tcb->ttb, 0x20100000, 0x20100000, 1, 0);
-        // Map the stack for the thread
-        memmgmt_map_any(tcb->ttb, tcb->r[THREAD_REG_SP] - 1*MB, 1, 1);
+    struct thread_tcb* child;
+    struct thread_tcb* owner;
+    uint8_t i;
 
-        // Setting up the mapping for the OS
-        for (i = MEMMGMT_TTB_ENTRIES - 256; i < MEMMGMT_TTB_ENTRIES; i++) {
-            memmgmt_map_page(tcb->ttb, i, i * MB, 0, 0);
-        }
+    child = thread_create((void*) parent->r[THREAD_REG_PC], parent->id, 0, 0);
+    if (!child) {
+        return 0;
     }
 
-    return tcb;
+    for (i = 0; i < 17; i++) {
+        child->r[i] = parent->r[i];
+    }
+    // The task threads are not copied, but their stacks are. Tasks cannot nest, so the stacks
+    // belong to the parent of a forking task.
+    owner = parent->flags & THREAD_FLAG_TASK ? &thread_tcb_list[parent->parent_id-1] : parent;
+    child->num_task_children = owner->num_task_children;
+
+    memmgmt_fork(parent->ttb, child->ttb);
+
+    return child;
+
 }
 
 /**
@@ -257,6 +328,7 @@ void thread_exit(struct thread_tcb* tcb, int32_t exit_code) {
  */
 void thread_activate(uint32_t id) {
     thread_tcb_list[id-1].status = THREAD_STATUS_READY;
+    thread_tcb_list[id-1].stamp = timer_read_clock();
 }
 
 /**
@@ -268,11 +340,117 @@ void thread_deactivate(uint32_t id) {
     thread_tcb_list[id-1].status = THREAD_STATUS_INACTIVE;
 }
 
+/**
+ * Takes a snapshot of the statistics of all threads.
+ * 
+ * @param stats     Pointer to the array to write the snapshot into
+ * @param max       The number of entries in the array
+ * 
+ * @return          The number of entries written
+ */
+__attribute__((section(".iram")))
+uint32_t thread_get_stats(struct thread_stats* stats, uint32_t max) {
+
+    uint32_t i;
+    uint32_t num = 0;
+    uint64_t now = timer_read_clock();
+    uint64_t run_time;
+    struct thread_tcb* tcb;
+
+    for (i = 0; i < THREAD_MAX_THREADS && num < max; i++) {
+        tcb = &thread_tcb_list[i];
+        if (!tcb->id) {
+            continue;
+        }
+
+        // Include the running thread's current time slice
+        run_time = tcb->run_time;
+        if (tcb == thread_accounted) {
+            run_time += now - tcb->stamp;
+        }
+
+        stats[num].id               = tcb->id;
+        stats[num].parent_id        = tcb->parent_id;
+        stats[num].status           = tcb->status;
+        stats[num].switches_vol     = tcb->switches_vol;
+        stats[num].switches_invol   = tcb->switches_invol;
+        stats[num].wakeups          = tcb->wakeups;
+        stats[num].run_time         = timer_clock_to_ns(run_time);
+        stats[num].ready_time       = timer_clock_to_ns(tcb->ready_time);
+        num++;
+    }
+
+    return num;
+
+}
+
 /* END Thread management functions */
 
 
+/* BEGIN Scheduling functions */
+
+/**
+ * Accounts the run time of the thread that has been running and the time the given thread has
+ * been waiting to run.
+ * 
+ * @param next      A pointer to the TCB of the thread that runs from now on
+ */
+__attribute__((section(".iram")))
+void thread_account_switch(struct thread_tcb* next) {
+
+    uint64_t now = timer_read_clock();
+
+    trace_switch(thread_accounted ? thread_accounted->id : 0, next->id);
+
+    if (thread_accounted) {
+        thread_accounted->run_time += now - thread_accounted->stamp;
+        thread_accounted->stamp = now;
+    }
+
+    next->ready_time += now - next->stamp;
+    next->stamp = now;
+    thread_accounted = next;
+
+}
+
+/**
+ * Returns whether a thread other than the current one and the idle thread is ready to run.
+ * 
+ * @return          1 iff there is another ready thread, 0 otherwise
+ */
+__attribute__((section(".iram")))
+uint8_t thread_others_ready(void) {
+
+    uint32_t i;
+
+    for (i = 1; i < THREAD_MAX_THREADS; i++) {
+        if (i != thread_sched_cur_idx && thread_tcb_list[i].id
+                && thread_tcb_list[i].status == THREAD_STATUS_READY) {
+            return 1;
+        }
+    }
+    return 0;
+
+}
+
+/* END Scheduling functions */
+
+
 /* BEGIN Functions to manage blocking reasons */
 
+/**
+ * Marks a blocked thread as ready again.
+ * 
+ * @param tcb       A pointer to the thread's TCB
+ */
+__attribute__((section(".iram")))
+void thread_wake(struct thread_tcb* tcb) {
+    tcb->status = THREAD_STATUS_READY;
+    tcb->stamp = timer_read_clock();
+    tcb->wakeups++;
+    trace(TRACE_WAKE, tcb->id, 0);
+}
+
 /**
  * Marks the current thread as blocked with the reason that it is waiting for input.
  */
@@ -304,6 +482,7 @@ inline void thread_block_for_char(struct thread_tcb* tcb) {
  * 
  * @return          A pointer to the thread that has been unblocked
  */
+__attribute__((section(".iram")))
 struct thread_tcb* thread_unblock_for_input(void) {
 
     struct thread_tcb* tcb;
@@ -314,7 +493,7 @@ struct thread_tcb* thread_unblock_for_input(void) {
     }
 
     tcb = &thread_tcb_list[thread_to_activate];
-    tcb->status = THREAD_STATUS_READY;
+    thread_wake(tcb);
 
     return tcb;
 
@@ -325,6 +504,7 @@ struct thread_tcb* thread_unblock_for_input(void) {
  * 
  * @return          A pointer to the thread that has been unblocked
  */
+__attribute__((section(".iram")))
 struct thread_tcb* thread_unblock_for_char(void) {
 
     struct thread_tcb* tcb;
@@ -335,7 +515,7 @@ struct thread_tcb* thread_unblock_for_char(void) {
     }
 
     tcb = &thread_tcb_list[thread_to_activate];
-    tcb->status = THREAD_STATUS_READY;
+    thread_wake(tcb);
 
     return tcb;
 
@@ -344,49 +524,87 @@ struct thread_tcb* thread_unblock_for_char(void) {
 
 /**
  * Marks the current thread as blocked with the reason that it is waiting for a timer to finish.
+ * The time to sleep is given in ms in r7.
  */
 inline void thread_block_for_timer(struct thread_tcb* tcb) {
 
     // Set the current thread as blocked
     tcb->status = THREAD_STATUS_BLOCKED;
 
-    // Write the thread to the blocked array
-    threads_blocked_for_timer[tcb->id - 1] = (uint32_t) tcb->r[7];
+    // Write the thread's deadline to the blocked array
+    threads_blocked_for_timer[tcb->id - 1] = timer_read_clock() + timer_ms_to_clock(tcb->r[7]);
+    thread_update_timer_alarm();
 
 }
 
 /**
  * Marks all threads as unblocked whose timers have finished.
+ * 
+ * @return          The number of threads that have been unblocked
  */
-void thread_unblock_for_timer(void) {
+__attribute__((section(".iram")))
+uint8_t thread_unblock_for_timer(void) {
 
     uint32_t i;
+    uint8_t unblocked = 0;
+    uint64_t now = timer_read_clock();
 
     for (i = 0; i < THREAD_MAX_THREADS; i++) {
-        if (threads_blocked_for_timer[i] == -1) {
+        if (!threads_blocked_for_timer[i] || threads_blocked_for_timer[i] > now) {
             continue;
         }
-        if (!threads_blocked_for_timer[i]--) {
-            thread_tcb_list[i].status = THREAD_STATUS_READY;
-            thread_tcb_list[i].r[7] = 0;
-        }
+        thread_wake(&thread_tcb_list[i]);
+        thread_tcb_list[i].r[7] = 0;
+        threads_blocked_for_timer[i] = 0;
+        unblocked++;
     }
 
+    thread_update_timer_alarm();
+    return unblocked;
+
 }
 
 /**
  * Marks a thread as unblocked with the reason that its timer has been interrupted.
+ * The remaining time is written in ms to r7.
  * 
  * @param tcb       A pointer to the thread to unblock
  */
 void thread_unblock_for_timer_prematurely(struct thread_tcb* tcb) {
 
-    if (threads_blocked_for_timer[tcb->id - 1] == -1) {
+    uint64_t deadline = threads_blocked_for_timer[tcb->id - 1];
+    uint64_t now;
+
+    if (!deadline) {
         return;
     }
-    tcb->status = THREAD_STATUS_READY;
-    tcb->r[7] = threads_blocked_for_timer[tcb->id - 1];
-    threads_blocked_for_timer[tcb->id - 1] = -1;
+
+    now = timer_read_clock();
+    thread_wake(tcb);
+    tcb->r[7] = deadline > now ? timer_clock_to_ms(deadline - now) : 0;
+    threads_blocked_for_timer[tcb->id - 1] = 0;
+
+    thread_update_timer_alarm();
+
+}
+
+/**
+ * Sets the timer's alarm to the earliest deadline of all sleeping threads so they are woken up in
+ * between two ticks of the Period Interval Timer.
+ */
+__attribute__((section(".iram")))
+void thread_update_timer_alarm(void) {
+
+    uint32_t i;
+    uint64_t earliest = 0;
+
+    for (i = 0; i < THREAD_MAX_THREADS; i++) {
+        if (threads_blocked_for_timer[i] && (!earliest || threads_blocked_for_timer[i] < earliest)) {
+            earliest = threads_blocked_for_timer[i];
+        }
+    }
+
+    timer_set_alarm(earliest);
 
 }
 
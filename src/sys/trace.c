@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Functions for tracing kernel events into a ring buffer.
+ */
+
+
+#include "sys/trace.h"
+#include "drivers/dbgu.h"
+#include "drivers/interrupt.h"
+#include "drivers/timer.h"
+#include "lib/inttypes.h"
+
+
+#if TRACE_ENABLED
+
+struct trace_record trace_ring[TRACE_SIZE];
+
+// Free-running index of the next record, the ring buffer is never drained and overwrites the oldest
+// records
+uint32_t trace_head;
+
+// The ID of the thread that is running, as seen by the tracepoints
+uint16_t trace_tid;
+
+
+/**
+ * Records an event in the ring buffer.
+ * The record is claimed and written with IRQs disabled, so tracepoints can be used in any context
+ * without locks.
+ * 
+ * @param event     The event's ID
+ * @param arg0      The first event-specific argument
+ * @param arg1      The second event-specific argument
+ */
+__attribute__((section(".iram")))
+void trace_record(uint16_t event, uint32_t arg0, uint32_t arg1) {
+
+    uint32_t time = (uint32_t) timer_read_clock();
+    uint32_t cpsr = interrupt_disable_irq_save();
+    struct trace_record* rec = &trace_ring[trace_head++ & (TRACE_SIZE - 1)];
+
+    rec->time = time;
+    rec->event = event;
+    rec->tid = trace_tid;
+    rec->arg0 = arg0;
+    rec->arg1 = arg1;
+
+    interrupt_restore_irq(cpsr);
+
+}
+
+/**
+ * Records a thread switch and attributes all following events to the next thread.
+ * 
+ * @param prev      The ID of the thread that has been running
+ * @param next      The ID of the thread that runs from now on
+ */
+__attribute__((section(".iram")))
+void trace_record_switch(uint32_t prev, uint32_t next) {
+    trace_record(TRACE_SWITCH, prev, next);
+    trace_tid = next;
+}
+
+/**
+ * Writes the ring buffer to the DBGU, bypassing the output buffer.
+ * The dump consists of a struct trace_header followed by the records, all in little endian. IRQs
+ * are disabled while it is written, so this stalls the system for some hundred ms.
+ */
+void trace_dump(void) {
+
+    uint32_t cpsr = interrupt_disable_irq_save();
+    struct trace_header header;
+    uint32_t i;
+
+    header.magic = TRACE_MAGIC;
+    header.total = trace_head;
+    header.count = trace_head < TRACE_SIZE ? trace_head : TRACE_SIZE;
+    header.clock_hz = TIMER_CLOCK_HZ;
+    dbgu_write_bytes((uint8_t*) &header, sizeof(header));
+
+    // Oldest record first
+    for (i = trace_head - header.count; i != trace_head; i++) {
+        dbgu_write_bytes((uint8_t*) &trace_ring[i & (TRACE_SIZE - 1)], sizeof(struct trace_record));
+    }
+
+    interrupt_restore_irq(cpsr);
+
+}
+
+#else
+
+void trace_dump(void) {
+}
+
+#endif /* TRACE_ENABLED */
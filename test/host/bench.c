@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Microbenchmarks of the portable library code and the kernel's allocator, run on the host with
+ * `make host-bench`. Like the in-guest benchmark application, each benchmark runs several times and
+ * the fastest run is printed as `BENCH <name> <iterations> <total time in ns>` in hexadecimal.
+ */
+
+
+#include "harness.h"
+#include "lib/buffer.h"
+#include "lib/math.h"
+#include "lib/mem.h"
+#include "lib/string.h"
+#include "sys/kmem.h"
+
+
+#define BENCH_RUNS      3
+#define RING_CAP        256
+#define CHUNK           64
+#define BLOCK           4096
+#define KMEM_ARENA      (3 * 1024)
+#define KMEM_BLOCKS     32
+
+
+typedef void (*bench_func)(uint32_t);
+
+
+// Results are written here so the compiler cannot drop the benchmarked calls
+volatile uint32_t bench_sink;
+
+uint8_t bench_src[BLOCK];
+uint8_t bench_dst[BLOCK];
+uint8_t* bench_arena;
+
+
+/**
+ * Runs a benchmark several times and prints the fastest run.
+ * 
+ * @param name      The benchmark's name
+ * @param func      The benchmark, which gets the number of iterations
+ * @param iter      The number of iterations per run
+ */
+void bench_run(const char* name, bench_func func, uint32_t iter) {
+
+    uint64_t best = UINT64_MAX;
+    uint64_t start;
+    uint64_t ns;
+    uint32_t run;
+
+    for (run = 0; run < BENCH_RUNS; run++) {
+        start = harness_now();
+        func(iter);
+        ns = harness_now() - start;
+        if (ns < best) {
+            best = ns;
+        }
+    }
+
+    harness_report(name, iter, best);
+
+}
+
+
+/* BEGIN Benchmarks */
+
+void bench_ring(uint32_t iter) {
+
+    int8_t raw[RING_CAP];
+    int8_t chunk[CHUNK] = {0};
+    struct ring_buffer rb;
+
+    ring_init(&rb, raw, RING_CAP);
+    while (iter--) {
+        ring_write(&rb, chunk, CHUNK);
+        bench_sink += ring_read(&rb, chunk, CHUNK);
+    }
+
+}
+
+void bench_interpolate(uint32_t iter) {
+
+    char target[512];
+    uint32_t args[4] = {'A', '1', 0x1234, 0xBEEF};
+
+    while (iter--) {
+        bench_sink += interpolate_core(target, sizeof(target), "%c%c: %x (%x)\n", args);
+    }
+
+}
+
+void bench_div_small(uint32_t iter) {
+    while (iter--) {
+        bench_sink += math_div(1000 + iter % 7, 100);
+    }
+}
+
+void bench_div_large(uint32_t iter) {
+    while (iter--) {
+        bench_sink += math_div(1000000 + iter % 7, 100);
+    }
+}
+
+void bench_mod(uint32_t iter) {
+    while (iter--) {
+        bench_sink += math_mod(1000 + iter % 7, 100);
+    }
+}
+
+void bench_memcopy(uint32_t iter) {
+    while (iter--) {
+        memcopy(bench_dst, bench_src, BLOCK);
+        bench_sink += bench_dst[iter % BLOCK];
+    }
+}
+
+void bench_memzero(uint32_t iter) {
+    while (iter--) {
+        memzero(bench_dst, BLOCK);
+        bench_sink += bench_dst[iter % BLOCK];
+    }
+}
+
+void bench_kmem(uint32_t iter) {
+
+    struct kmem_header* first = kmem_init(bench_arena, KMEM_ARENA);
+    void* blocks[KMEM_BLOCKS];
+    uint32_t i;
+
+    while (iter--) {
+        for (i = 0; i < KMEM_BLOCKS; i++) {
+            blocks[i] = kmem_alloc(first, 48);
+        }
+        for (i = 0; i < KMEM_BLOCKS; i++) {
+            kmem_free(first, blocks[i]);
+        }
+    }
+    bench_sink += kmem_count_free(first);
+
+}
+
+/* END Benchmarks */
+
+
+int main(void) {
+
+    bench_arena = harness_alloc_low(KMEM_ARENA);
+
+    printf("BENCH begin\n");
+
+    bench_run("host_ring_64", &bench_ring, 100000);
+    bench_run("host_interpolate", &bench_interpolate, 100000);
+    bench_run("host_div_small", &bench_div_small, 1000000);
+    bench_run("host_div_large", &bench_div_large, 10000);
+    bench_run("host_mod", &bench_mod, 1000000);
+    bench_run("host_memcopy_4k", &bench_memcopy, 10000);
+    bench_run("host_memzero_4k", &bench_memzero, 10000);
+    bench_run("host_kmem_32", &bench_kmem, 10000);
+
+    printf("BENCH end\n");
+    return 0;
+
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Helpers for the host-native tests and benchmarks of the portable library code.
+ */
+
+
+#include <sys/mman.h>
+
+#include "harness.h"
+
+
+#ifndef MAP_32BIT
+#define MAP_32BIT   0
+#endif
+
+
+unsigned harness_failed;
+
+uint32_t harness_state = 1;
+
+
+void harness_seed(uint32_t seed) {
+    harness_state = seed;
+}
+
+uint32_t harness_rand(void) {
+    harness_state ^= harness_state << 13;
+    harness_state ^= harness_state >> 17;
+    harness_state ^= harness_state << 5;
+    return harness_state;
+}
+
+uint32_t harness_range(uint32_t lo, uint32_t hi) {
+    return lo + harness_rand() % (hi - lo + 1);
+}
+
+void* harness_alloc_low(size_t size) {
+
+    void* mem = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+
+    if (mem == MAP_FAILED || (uintptr_t) mem + size > 0xFFFFFFFFu) {
+        fprintf(stderr, "cannot allocate %u bytes below 4 GB\n", (unsigned) size);
+        exit(2);
+    }
+    return mem;
+
+}
+
+uint64_t harness_now(void) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+
+}
+
+void harness_report(const char* name, uint32_t iter, uint64_t ns) {
+    printf("BENCH %s %x %x\n", name, iter, (uint32_t) (ns > 0xFFFFFFFFu ? 0xFFFFFFFFu : ns));
+}
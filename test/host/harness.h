@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Helpers for the host-native tests and benchmarks of the portable library code.
+ * 
+ * The library's headers define the fixed-size integer types as macros, so all system headers have
+ * to be included before them. This header includes the ones the tests and benchmarks need, except
+ * for <string.h> whose strnlen() clashes with the library's, use the compiler's builtins instead.
+ */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "lib/inttypes.h"
+
+
+#ifndef HARNESS_H_
+#define HARNESS_H_
+
+
+// Fails the current test with a message if a condition does not hold
+#define CHECK(cond, ...) \
+        do { \
+            if (!(cond)) { \
+                fprintf(stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__, #cond); \
+                fprintf(stderr, __VA_ARGS__); \
+                fprintf(stderr, "\n"); \
+                harness_failed++; \
+                return; \
+            } \
+        } while (0)
+
+
+extern unsigned harness_failed;
+
+
+/**
+ * Seeds the pseudo-random number generator.
+ * 
+ * @param seed      The seed, must not be 0
+ */
+void harness_seed(uint32_t seed);
+
+/**
+ * Returns a pseudo-random number (xorshift32), so failures can be reproduced from the seed.
+ * 
+ * @return          The number
+ */
+uint32_t harness_rand(void);
+
+/**
+ * Returns a pseudo-random number in a range.
+ * 
+ * @param lo        The lower bound
+ * @param hi        The upper bound (inclusive)
+ * 
+ * @return          The number
+ */
+uint32_t harness_range(uint32_t lo, uint32_t hi);
+
+/**
+ * Allocates memory below 4 GB, since the kernel's allocator stores pointers in 32 bits.
+ * 
+ * @param size      The size in bytes
+ * 
+ * @return          A pointer to the memory
+ */
+void* harness_alloc_low(size_t size);
+
+/**
+ * Returns the time of a monotonic clock.
+ * 
+ * @return          The time in ns
+ */
+uint64_t harness_now(void);
+
+/**
+ * Prints a benchmark result in the format of the in-guest benchmark application.
+ * 
+ * @param name      The benchmark's name
+ * @param iter      The number of iterations
+ * @param ns        The total time of all iterations in ns
+ */
+void harness_report(const char* name, uint32_t iter, uint64_t ns);
+
+
+#endif /* HARNESS_H_ */
@@ -0,0 +1,628 @@
+/*
+ * Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+ * 
+ * Randomised correctness tests of the portable library code, the kernel's allocator, its deferred
+ * work and system calls, run on the host with `make host-test`. The interrupt primitives the deferred
+ * work uses are stubbed with a model of the IRQ signal and the latency measurement's IRQ-disabled
+ * sections, the kernel functions the system calls use with a model of their results.
+ * 
+ * Usage: test [seed] [rounds]
+ * 
+ * A seed of 0 or none picks one from the time, the default are 1000 rounds.
+ */
+
+
+#include "harness.h"
+#include "drivers/interrupt.h"
+#include "drivers/timer.h"
+#include "lib/buffer.h"
+#include "lib/math.h"
+#include "lib/mem.h"
+#include "lib/string.h"
+#include "sys/defer.h"
+#include "sys/io.h"
+#include "sys/kmem.h"
+#include "sys/latency.h"
+#include "sys/memmgmt.h"
+#include "sys/profile.h"
+#include "sys/swi.h"
+#include "sys/thread.h"
+#include "sys/trace.h"
+
+
+#define GUARD           0xA5
+#define RING_CAP_MAX    64
+#define KMEM_ARENA      (3 * 1024)
+#define KMEM_SLOTS      32
+
+
+/* BEGIN Ring buffer */
+
+void test_ring(void) {
+
+    int8_t raw[RING_CAP_MAX];
+    int8_t model[RING_CAP_MAX];
+    int8_t data[RING_CAP_MAX];
+    int8_t out[RING_CAP_MAX];
+    struct ring_buffer rb;
+    size_t cap = harness_range(1, RING_CAP_MAX);
+    size_t len = 0;
+    size_t size;
+    size_t done;
+    size_t i;
+    uint32_t op;
+
+    ring_init(&rb, raw, cap);
+
+    for (op = 0; op < 1000; op++) {
+        size = harness_range(0, cap + 2);
+
+        switch (harness_rand() % 3) {
+
+        case 0:
+            for (i = 0; i < size; i++) {
+                data[i % RING_CAP_MAX] = (int8_t) harness_rand();
+            }
+            size = size > RING_CAP_MAX ? RING_CAP_MAX : size;
+            done = ring_write(&rb, data, size);
+            CHECK(done == (size < cap - len ? size : cap - len), "write %u into %u/%u returned %u",
+                    (unsigned) size, (unsigned) len, (unsigned) cap, (unsigned) done);
+            __builtin_memcpy(&model[len], data, done);
+            len += done;
+            break;
+
+        case 1:
+            size = size > RING_CAP_MAX ? RING_CAP_MAX : size;
+            done = ring_peek(&rb, out, size);
+            CHECK(done == (size < len ? size : len), "peek of %u returned %u", (unsigned) size,
+                    (unsigned) done);
+            CHECK(!__builtin_memcmp(out, model, done), "peek returned wrong data");
+            break;
+
+        default:
+            size = size > RING_CAP_MAX ? RING_CAP_MAX : size;
+            done = ring_read(&rb, out, size);
+            CHECK(done == (size < len ? size : len), "read of %u returned %u", (unsigned) size,
+                    (unsigned) done);
+            CHECK(!__builtin_memcmp(out, model, done), "read returned wrong data");
+            __builtin_memmove(model, &model[done], len - done);
+            len -= done;
+            break;
+        }
+
+        CHECK(ring_is_empty(&rb) == (len == 0), "emptiness differs at length %u", (unsigned) len);
+        CHECK(ring_is_full(&rb) == (len == cap), "fullness differs at length %u", (unsigned) len);
+    }
+
+}
+
+/* END Ring buffer */
+
+
+/* BEGIN Math */
+
+void test_math(void) {
+
+    uint32_t dividend;
+    uint32_t divisor;
+    uint32_t shift;
+    uint32_t i;
+
+    for (i = 0; i < 1000; i++) {
+        // Keep the quotients small, the division subtracts the divisor until it does not fit
+        divisor = harness_range(1, 0xFFFF);
+        dividend = divisor * harness_range(0, 2000) + harness_rand() % divisor;
+        CHECK(math_div(dividend, divisor) == dividend / divisor, "%u / %u", dividend, divisor);
+        CHECK(math_mod(dividend, divisor) == dividend % divisor, "%u %% %u", dividend, divisor);
+
+        shift = harness_range(0, 31);
+        dividend = harness_rand();
+        CHECK(math_log2(1u << shift) == shift, "log2(1 << %u)", shift);
+        CHECK(math_div(dividend, 1u << shift) == dividend >> shift, "%u / 2^%u", dividend, shift);
+        CHECK(math_mod(dividend, 1u << shift) == (dividend & ((1u << shift) - 1)), "%u %% 2^%u",
+                dividend, shift);
+    }
+
+}
+
+/* END Math */
+
+
+/* BEGIN Memory */
+
+void test_mem(void) {
+
+    uint8_t src[256];
+    uint8_t dst[256 + 2];
+    size_t size = harness_range(0, 256);
+    size_t i;
+
+    for (i = 0; i < sizeof(src); i++) {
+        src[i] = (uint8_t) harness_rand();
+    }
+
+    // The bytes around the destination must stay untouched
+    __builtin_memset(dst, GUARD, sizeof(dst));
+    memcopy(&dst[1], src, size);
+    CHECK(dst[0] == GUARD && dst[size + 1] == GUARD, "memcopy of %u bytes wrote out of bounds",
+            (unsigned) size);
+    CHECK(!__builtin_memcmp(&dst[1], src, size), "memcopy of %u bytes copied wrong data", (unsigned) size);
+
+    __builtin_memset(dst, GUARD, sizeof(dst));
+    memzero(&dst[1], size);
+    CHECK(dst[0] == GUARD && dst[size + 1] == GUARD, "memzero of %u bytes wrote out of bounds",
+            (unsigned) size);
+    for (i = 1; i <= size; i++) {
+        CHECK(!dst[i], "memzero of %u bytes left byte %u", (unsigned) size, (unsigned) i - 1);
+    }
+
+}
+
+/* END Memory */
+
+
+/* BEGIN String interpolation */
+
+void test_interpolate(void) {
+
+    static char* strings[] = {"", "a", "ChaOS", "%x"};
+    char format[32];
+    char expected[512];
+    char target[512 + 1];
+    uint8_t args[32 * 8];
+    uint8_t* arg = args;
+    size_t format_len = harness_range(0, sizeof(format) - 1);
+    size_t expected_len = 0;
+    size_t cap;
+    size_t len;
+    size_t i;
+    uint32_t word;
+    char* string;
+
+    // Build a random format string and the expected output, the arguments are laid out in memory
+    // as interpolate_core() expects them
+    for (i = 0; i < format_len; i++) {
+        if (harness_rand() % 3 || i + 1 == format_len) {
+            format[i] = (char) harness_range('a', 'z');
+            expected[expected_len++] = format[i];
+            continue;
+        }
+
+        format[i++] = '%';
+        switch (harness_rand() % 5) {
+        case 0:
+            format[i] = '%';
+            expected[expected_len++] = '%';
+            break;
+        case 1:
+            format[i] = 'c';
+            word = harness_range('A', 'Z');
+            __builtin_memcpy(arg, &word, 4);
+            arg += 4;
+            expected[expected_len++] = (char) word;
+            break;
+        case 2:
+            format[i] = 's';
+            string = strings[harness_rand() % 4];
+            __builtin_memcpy(arg, &string, sizeof(char*));
+            arg += sizeof(char*);
+            expected_len += sprintf(&expected[expected_len], "%s", string);
+            break;
+        case 3:
+            format[i] = harness_rand() % 2 ? 'x' : 'p';
+            word = harness_rand();
+            __builtin_memcpy(arg, &word, 4);
+            arg += 4;
+            expected_len += sprintf(&expected[expected_len], "%08X", word);
+            break;
+        default:
+            format[i] = 'q';
+            expected[expected_len++] = '%';
+            expected[expected_len++] = 'q';
+            break;
+        }
+    }
+    format[format_len] = 0;
+    expected[expected_len] = 0;
+
+    // With enough room, the whole string and its terminator are written
+    len = interpolate_core(target, sizeof(target) - 1, format, args);
+    CHECK(len == expected_len + 1, "\"%s\" returned %u instead of %u", format, (unsigned) len,
+            (unsigned) expected_len + 1);
+    CHECK(!__builtin_strcmp(target, expected), "\"%s\" gave \"%s\" instead of \"%s\"", format, target, expected);
+
+    // With less room, a prefix is written and nothing beyond the capacity
+    cap = harness_range(0, expected_len + 1);
+    __builtin_memset(target, GUARD, sizeof(target));
+    len = interpolate_core(target, cap, format, args);
+    CHECK(len <= cap, "\"%s\" with capacity %u returned %u", format, (unsigned) cap, (unsigned) len);
+    CHECK((uint8_t) target[cap] == GUARD, "\"%s\" with capacity %u wrote out of bounds", format,
+            (unsigned) cap);
+    CHECK(!__builtin_memcmp(target, expected, len && !target[len - 1] ? len - 1 : len),
+            "\"%s\" with capacity %u wrote a wrong prefix", format, (unsigned) cap);
+
+    // The variate wrapper collects the arguments wherever the compiler passed them
+    word = harness_rand();
+    string = strings[harness_rand() % 4];
+    expected_len = sprintf(expected, "%c%s %08X%%", (char) (word & 0x3F) + 'A', string, word);
+    len = interpolate(target, sizeof(target) - 1, "%c%s %x%%", (word & 0x3F) + 'A', string, word);
+    CHECK(len == expected_len + 1 && !__builtin_strcmp(target, expected),
+            "interpolate() gave \"%s\" instead of \"%s\"", target, expected);
+
+}
+
+/* END String interpolation */
+
+
+/* BEGIN Kernel memory allocator */
+
+/**
+ * Checks that the headers are linked consistently and that the reserved bits agree.
+ */
+void kmem_check_links(struct kmem_header* first, uint32_t size, const char* op) {
+
+    struct kmem_header* header = first;
+    struct kmem_header* next;
+
+    while ((next = kmem_next(header))) {
+        if (!(kmem_prev(next) == header)) {
+            fprintf(stderr, "after %s: broken back link at offset %u\n", op,
+                    (unsigned) ((uint8_t*) next - (uint8_t*) first));
+            harness_failed++;
+            return;
+        }
+        if ((next->prev & 1) != (header->next & 1)) {
+            fprintf(stderr, "after %s: reserved bits disagree at offset %u\n", op,
+                    (unsigned) ((uint8_t*) header - (uint8_t*) first));
+            harness_failed++;
+            return;
+        }
+        header = next;
+    }
+
+    if ((uint8_t*) header + sizeof(struct kmem_header) != (uint8_t*) first + size) {
+        fprintf(stderr, "after %s: the last header is not at the end\n", op);
+        harness_failed++;
+    }
+
+}
+
+void test_kmem(void) {
+
+    static uint8_t* arena;
+    uint8_t* slots[KMEM_SLOTS];
+    uint32_t sizes[KMEM_SLOTS];
+    struct kmem_header* first;
+    uint32_t initial;
+    uint32_t size;
+    uint32_t i;
+    uint32_t j;
+    uint32_t op;
+
+    if (!arena) {
+        arena = harness_alloc_low(KMEM_ARENA);
+    }
+    __builtin_memset(slots, 0, sizeof(slots));
+
+    first = kmem_init(arena, KMEM_ARENA);
+    CHECK(first, "init failed");
+    initial = kmem_count_free(first);
+    CHECK(initial == KMEM_ARENA - 2 * sizeof(struct kmem_header), "%u bytes free after init",
+            initial);
+
+    for (op = 0; op < 500; op++) {
+        i = harness_rand() % KMEM_SLOTS;
+
+        if (slots[i]) {
+            // The allocation must not have been overwritten by others
+            for (j = 0; j < sizes[i]; j++) {
+                CHECK(slots[i][j] == (uint8_t) i, "slot %u was overwritten", i);
+            }
+            kmem_free(first, slots[i]);
+            slots[i] = 0;
+            kmem_check_links(first, KMEM_ARENA, "free");
+            continue;
+        }
+
+        size = harness_range(1, 256);
+        slots[i] = kmem_alloc(first, size);
+        kmem_check_links(first, KMEM_ARENA, "alloc");
+        if (!slots[i]) {
+            continue;
+        }
+
+        sizes[i] = size;
+        CHECK(slots[i] >= arena && slots[i] + size <= arena + KMEM_ARENA,
+                "allocation of %u bytes is outside the arena", size);
+        __builtin_memset(slots[i], (uint8_t) i, size);
+    }
+
+    for (i = 0; i < KMEM_SLOTS; i++) {
+        if (slots[i]) {
+            kmem_free(first, slots[i]);
+        }
+    }
+
+    // Freeing everything must join all entries again
+    CHECK(!kmem_count_alloc(first), "%u bytes still allocated", kmem_count_alloc(first));
+    CHECK(kmem_count_free(first) == initial, "%u bytes free instead of %u", kmem_count_free(first),
+            initial);
+
+}
+
+/* END Kernel memory allocator */
+
+
+/* BEGIN Deferred work */
+
+// Whether the modelled IRQ signal is disabled, and whether an IRQ-disabled section is measured
+uint8_t stub_irqs_off;
+uint8_t stub_section_open;
+uint32_t stub_sections;
+uint32_t stub_work_done;
+uint32_t stub_work_raise;
+
+uint32_t interrupt_disable_irq_save(void) {
+
+    uint32_t cpsr = stub_irqs_off ? 0x80 : 0;
+
+    // Sections do not nest, a section started while another one is open is part of it
+    if (!stub_irqs_off) {
+        stub_section_open = 1;
+    }
+    stub_irqs_off = 1;
+    return cpsr;
+
+}
+
+uint32_t interrupt_disable_irq_save_raw(void) {
+
+    uint32_t cpsr = stub_irqs_off ? 0x80 : 0;
+
+    stub_irqs_off = 1;
+    return cpsr;
+
+}
+
+void interrupt_restore_irq(uint32_t cpsr) {
+
+    if (!(cpsr & 0x80) && stub_section_open) {
+        stub_section_open = 0;
+        stub_sections++;
+    }
+    stub_irqs_off = (cpsr & 0x80) ? 1 : 0;
+
+}
+
+void trace_record(uint16_t event, uint32_t arg0, uint32_t arg1) {
+    UNUSED(event);
+    UNUSED(arg0);
+    UNUSED(arg1);
+}
+
+// Every work item records that it ran, and raises the items in stub_work_raise like a top half
+void stub_work(uint8_t work) {
+
+    stub_work_done |= 1 << work;
+    defer_pending |= stub_work_raise;
+    stub_work_raise = 0;
+
+}
+
+void interrupt_work_timer(void) {
+    stub_work(DEFER_TIMER);
+}
+
+void interrupt_work_dbgu_rx(void) {
+    stub_work(DEFER_DBGU_RX);
+}
+
+void interrupt_work_dbgu_tx(void) {
+    stub_work(DEFER_DBGU_TX);
+}
+
+void interrupt_work_alarm(void) {
+    stub_work(DEFER_ALARM);
+}
+
+void interrupt_work_zero(void) {
+    stub_work(DEFER_ZERO);
+}
+
+void test_defer(void) {
+
+    uint32_t all = (1 << (DEFER_ZERO + 1)) - 1;
+    uint32_t pending = harness_rand() & all;
+    uint32_t sections;
+    uint32_t cpsr;
+
+    // As for an IRQ that has interrupted user mode, the work runs with IRQs enabled
+    stub_irqs_off = 0;
+    stub_section_open = 0;
+    stub_work_done = 0;
+    stub_work_raise = pending ? harness_rand() & all : 0;
+    defer_pending = pending;
+    pending |= stub_work_raise;
+
+    defer_run();
+    CHECK(stub_work_done == pending, "ran work 0x%x instead of 0x%x", stub_work_done, pending);
+    CHECK(!defer_pending, "work 0x%x is still pending", defer_pending);
+    CHECK(stub_irqs_off, "returned with IRQs enabled");
+    CHECK(!stub_section_open, "left an IRQ-disabled section open");
+
+    // The exception return enables IRQs again, the next section has to be measured on its own
+    stub_irqs_off = 0;
+    sections = stub_sections;
+    cpsr = interrupt_disable_irq_save();
+    interrupt_restore_irq(cpsr);
+    CHECK(stub_sections == sections + 1, "the next IRQ-disabled section was not recorded");
+
+}
+
+/* END Deferred work */
+
+
+/* BEGIN System calls */
+
+// The thread table the scheduler's inline functions use, and the stubbed thread management
+struct thread_tcb thread_tcb_list[THREAD_MAX_THREADS];
+uint8_t thread_switch_counter;
+uint32_t thread_sched_cur_idx;
+uint8_t stub_space_full;
+uint32_t stub_activated;
+// The number of bytes the stubbed DBGU has received, and how often they have been read
+uint32_t stub_input;
+uint32_t stub_input_reads;
+
+struct thread_tcb* thread_create(void* text, uint32_t par_id, int8_t is_task, uint32_t is_idle) {
+
+    struct thread_tcb* child = &thread_tcb_list[1];
+
+    // Like the parent's address space at its hard limit
+    if (stub_space_full) {
+        return 0;
+    }
+    memzero((uint8_t*) child, sizeof(struct thread_tcb));
+    child->id = 2;
+    child->r[THREAD_REG_PC] = (uint32_t) (uintptr_t) text;
+    return child;
+
+}
+
+void thread_activate(uint32_t id) {
+    stub_activated = id;
+}
+
+// Never writes into the buffer, which is only an address of the modelled user space
+size_t io_dbgu_read_input_string(char* str, size_t maxlen) {
+    stub_input_reads++;
+    return maxlen < stub_input ? maxlen : stub_input;
+}
+
+// The modelled user space maps all of its part of the address space writable
+uint8_t memmgmt_user_writable(uint32_t* ttb, uint32_t address, uint32_t size) {
+    return !size || (address >= MEMMGMT_MMAP_START && address + size >= address
+            && address + size <= MEMMGMT_USER_END);
+}
+
+// The system calls the tests do not reach
+void io_dbgu_read_flush(void) {}
+size_t io_dbgu_write_output_string(char* str, size_t len) { return 0; }
+void latency_copy(struct latency_report* report, uint8_t reset) {}
+void memmgmt_get_stats(uint32_t* ttb, struct mem_stats* stats) {}
+uint32_t memmgmt_map_range(uint32_t* ttb, uint32_t address, uint32_t length, uint32_t prot,
+        uint32_t flags) { return 0; }
+void memmgmt_prepare_access(uint32_t* ttb, uint32_t address, uint32_t size, uint8_t write) {}
+uint8_t memmgmt_user_readable(uint32_t* ttb, uint32_t address, uint32_t size) { return 0; }
+uint8_t memmgmt_protect_range(uint32_t* ttb, uint32_t address, uint32_t length, uint32_t prot) {
+    return 0;
+}
+uint8_t memmgmt_set_limit(uint32_t* ttb, uint32_t sections) { return 0; }
+uint8_t memmgmt_unmap_range(uint32_t* ttb, uint32_t address, uint32_t length) { return 0; }
+uint32_t profile_copy(struct profile_sample* samples, uint32_t max) { return 0; }
+void profile_enable(uint8_t on) {}
+void thread_block_for_char(struct thread_tcb* tcb) {}
+void thread_block_for_input(struct thread_tcb* tcb) {}
+void thread_block_for_timer(struct thread_tcb* tcb) {}
+void thread_exit(struct thread_tcb* tcb, int32_t exit_code) {}
+struct thread_tcb* thread_fork(struct thread_tcb* parent) { return 0; }
+struct thread_tcb* thread_get_current(void) { return 0; }
+uint32_t thread_get_stats(struct thread_stats* stats, uint32_t max) { return 0; }
+uint8_t thread_others_ready(void) { return 0; }
+uint64_t timer_clock_to_ns(uint64_t clock) { return 0; }
+uint64_t timer_read_clock(void) { return 0; }
+void trace_dump(void) {}
+
+void test_thread_create(void) {
+
+    struct thread_tcb* parent = &thread_tcb_list[0];
+    uint32_t par0 = harness_rand();
+    uint32_t par1 = harness_rand();
+
+    memzero((uint8_t*) parent, sizeof(struct thread_tcb));
+    parent->id = 1;
+    parent->r[7] = 0x20100000;
+    parent->r[9] = par0;
+    parent->r[10] = par1;
+    stub_activated = 0;
+
+    // A space at its hard limit gets no new thread, and nothing is activated
+    stub_space_full = 1;
+    swi_thread_create(parent);
+    CHECK(parent->r[7] == (uint32_t) -1, "thread_create at the limit returned %x", parent->r[7]);
+    CHECK(!stub_activated, "thread_create at the limit activated thread %x", stub_activated);
+
+    parent->r[7] = 0x20100000;
+    stub_space_full = 0;
+    swi_thread_create(parent);
+    CHECK(parent->r[7] == 2, "thread_create returned %x instead of the child", parent->r[7]);
+    CHECK(stub_activated == 2, "thread_create activated %x instead of the child", stub_activated);
+    CHECK(thread_tcb_list[1].r[0] == par0 && thread_tcb_list[1].r[1] == par1,
+            "the child did not get its starting parameters");
+
+}
+
+void test_str_read(void) {
+
+    struct thread_tcb* tcb = &thread_tcb_list[0];
+    uint32_t length = harness_range(1, 4096);
+
+    memzero((uint8_t*) tcb, sizeof(struct thread_tcb));
+    tcb->id = 1;
+    stub_input = harness_range(1, 4096);
+    stub_input_reads = 0;
+
+    // A buffer in the kernel is refused before anything is read into it
+    tcb->r[7] = EXT_RAM + (harness_rand() & (PAGE_SIZE - 1));
+    tcb->r[8] = length;
+    swi_str_read(tcb);
+    CHECK(tcb->r[7] == (uint32_t) -1, "read_string into the kernel returned %x", tcb->r[7]);
+    CHECK(!stub_input_reads, "read_string read into the kernel");
+
+    tcb->r[7] = MEMMGMT_USER_END - length;
+    tcb->r[8] = length;
+    swi_str_read(tcb);
+    CHECK(tcb->r[7] == (length < stub_input ? length : stub_input),
+            "read_string returned %x for %x bytes of input", tcb->r[7], stub_input);
+    CHECK(stub_input_reads == 1, "read_string did not read into the user's buffer");
+
+}
+
+/* END System calls */
+
+
+int main(int argc, char** argv) {
+
+    uint32_t seed = argc > 1 ? (uint32_t) strtoul(argv[1], 0, 0) : 0;
+    uint32_t rounds = argc > 2 ? (uint32_t) strtoul(argv[2], 0, 0) : 0;
+    uint32_t round;
+
+    // A seed of 0 picks one from the time, a seed the generator could not use anyway
+    if (!seed) {
+        seed = (uint32_t) time(0) | 1;
+    }
+    if (!rounds) {
+        rounds = 1000;
+    }
+    printf("seed %u, %u rounds\n", seed, rounds);
+    harness_seed(seed);
+
+    for (round = 0; round < rounds && !harness_failed; round++) {
+        test_ring();
+        test_math();
+        test_mem();
+        test_interpolate();
+        test_kmem();
+        test_defer();
+        test_thread_create();
+        test_str_read();
+    }
+
+    if (harness_failed) {
+        printf("FAILED in round %u, rerun with seed %u\n", round - 1, seed);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+
+}
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+#
+# Runs the benchmark application under QEMU with instruction counting and compares the results
+# against a stored baseline.
+#
+# Usage: bench.py [--qemu <qemu>] [--kernel <kernel>] [--input <capture>] [--baseline <file>]
+#                 [--update] [--threshold <percent>] [--shift <n>] [--timeout <seconds>]
+#
+# With `-icount`, QEMU's virtual clock advances by 2^shift ns per executed instruction instead of
+# following the host's clock, so the timer the benchmarks measure with and the timer interrupts
+# become deterministic. With the default shift of 0, every reported nanosecond is one instruction.
+# Instead of booting a kernel, `--input` reads the BENCH lines from a capture (`-` for stdin),
+# e.g. the output of `make host-bench`.
+#
+# The baseline holds one `<name> <ns per iteration> [threshold in percent]` line per benchmark.
+# A benchmark regresses if it got slower than its threshold (or `--threshold`) allows, in which
+# case, or if a benchmark of the baseline is missing, the exit status is 1. `--update` writes the
+# current results as the new baseline, keeping the thresholds of benchmarks that were already in it.
+# No baseline is checked in, as the numbers depend on the QEMU build. Without one, the results are
+# printed with instructions on how to record it, and the exit status is 2.
+
+import argparse
+import os
+import re
+import select
+import subprocess
+import sys
+import time
+
+
+BENCH_LINE = re.compile(rb"^BENCH (\S+) ([0-9a-fA-F]+) ([0-9a-fA-F]+)\s*$")
+BENCH_BEGIN = b"BENCH begin"
+BENCH_END = b"BENCH end"
+
+
+def parse(lines):
+    """Returns the results between `BENCH begin` and `BENCH end` as ns per iteration by name."""
+    results, inside, complete = {}, False, False
+    for line in lines:
+        line = line.strip()
+        if line == BENCH_BEGIN:
+            inside = True
+        elif line == BENCH_END and inside:
+            complete = True
+            break
+        elif inside:
+            match = BENCH_LINE.match(line)
+            if match:
+                name, iterations, total = match.groups()
+                results[name.decode()] = int(total, 16) / max(int(iterations, 16), 1)
+    return results, complete
+
+
+def run_qemu(qemu, kernel, shift, timeout):
+    """Boots the kernel headlessly and returns the lines of serial output up to `BENCH end`."""
+    args = [qemu, "-M", "portux920t", "-m", "64M", "-nodefaults", "-display", "none",
+            "-serial", "stdio", "-icount", "shift=%d,sleep=off" % shift, "-kernel", kernel]
+    proc = subprocess.Popen(args, stdin=subprocess.DEVNULL, stdout=subprocess.PIPE)
+    lines, pending = [], b""
+    deadline = time.monotonic() + timeout
+    try:
+        while time.monotonic() < deadline:
+            ready, _, _ = select.select([proc.stdout], [], [], 0.5)
+            if not ready:
+                continue
+            chunk = os.read(proc.stdout.fileno(), 4096)
+            if not chunk:
+                break
+            pending += chunk
+            *complete, pending = pending.split(b"\n")
+            lines += complete
+            if any(line.strip() == BENCH_END for line in complete):
+                return lines
+        print("QEMU did not print `BENCH end` within %d s." % timeout, file=sys.stderr)
+        return lines + [pending]
+    finally:
+        proc.kill()
+        proc.wait()
+
+
+def read_baseline(path):
+    """Returns the baseline's values and thresholds by name, both empty if there is none."""
+    values, thresholds = {}, {}
+    if not os.path.exists(path):
+        return values, thresholds
+    with open(path) as f:
+        for line in f:
+            fields = line.split("#", 1)[0].split()
+            if not fields:
+                continue
+            values[fields[0]] = float(fields[1])
+            if len(fields) > 2:
+                thresholds[fields[0]] = float(fields[2])
+    return values, thresholds
+
+
+def write_baseline(path, results, thresholds, source):
+    with open(path, "w") as f:
+        f.write("# Written by tools/bench.py from %s\n" % source)
+        f.write("# <name> <ns per iteration> [threshold in percent]\n")
+        for name in sorted(results):
+            if name in thresholds:
+                f.write("%s %.1f %g\n" % (name, results[name], thresholds[name]))
+            else:
+                f.write("%s %.1f\n" % (name, results[name]))
+
+
+def compare(results, baseline, thresholds, default_threshold):
+    """Prints the comparison and returns whether there was no regression."""
+    ok = True
+    print("%-24s %14s %14s %9s" % ("benchmark", "baseline", "current", "change"))
+    for name in sorted(set(results) | set(baseline)):
+        if name not in results:
+            print("%-24s %14.1f %14s %9s  MISSING" % (name, baseline[name], "-", "-"))
+            ok = False
+            continue
+        if name not in baseline:
+            print("%-24s %14s %14.1f %9s  new" % (name, "-", results[name], "-"))
+            continue
+        change = 100.0 * (results[name] - baseline[name]) / max(baseline[name], 1)
+        threshold = thresholds.get(name, default_threshold)
+        verdict = ""
+        if change > threshold:
+            verdict = "  REGRESSION (> %g%%)" % threshold
+            ok = False
+        elif change < -threshold:
+            verdict = "  improved"
+        print("%-24s %14.1f %14.1f %+8.1f%%%s" % (name, baseline[name], results[name], change, verdict))
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Runs and compares the benchmark application.")
+    parser.add_argument("--qemu", default="qemu/build/arm-softmmu/qemu-system-arm")
+    parser.add_argument("--kernel", default="bin/kernel")
+    parser.add_argument("--input", help="read the results from a capture instead of running QEMU")
+    parser.add_argument("--baseline", default="tools/bench_baseline.txt")
+    parser.add_argument("--update", action="store_true", help="store the results as the baseline")
+    parser.add_argument("--threshold", type=float, default=2.0,
+                        help="allowed slowdown in percent for benchmarks without their own")
+    parser.add_argument("--shift", type=int, default=0, help="ns per instruction as a power of 2")
+    parser.add_argument("--timeout", type=int, default=300)
+    args = parser.parse_args()
+
+    if args.input == "-":
+        lines = sys.stdin.buffer.read().split(b"\n")
+    elif args.input:
+        with open(args.input, "rb") as f:
+            lines = f.read().split(b"\n")
+    else:
+        lines = run_qemu(args.qemu, args.kernel, args.shift, args.timeout)
+
+    results, complete = parse(lines)
+    if not complete:
+        print("No complete benchmark output found (is app 3 built?).", file=sys.stderr)
+        sys.exit(1)
+
+    baseline, thresholds = read_baseline(args.baseline)
+    if args.update:
+        source = args.input or "QEMU with -icount shift=%d" % args.shift
+        write_baseline(args.baseline, results, thresholds, source)
+        print("Wrote %d results to %s." % (len(results), args.baseline))
+        return
+    if not baseline:
+        compare(results, baseline, thresholds, args.threshold)
+        print("\nNo baseline in %s, there is nothing to compare against. Record one from an "
+              "unmodified tree with `make bench-baseline` (or --update), commit it and run again."
+              % args.baseline, file=sys.stderr)
+        sys.exit(2)
+
+    if not compare(results, baseline, thresholds, args.threshold):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,36 @@
+#
+# Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+#
+# Symbol lookup in the kernel ELF for the host-side tools.
+
+import bisect
+import subprocess
+
+
+NM = "arm-none-eabi-nm"
+
+
+class Symbols:
+    """The function symbols of the kernel ELF, which also contains the applications."""
+
+    def __init__(self, kernel):
+        out = subprocess.run([NM, "-n", kernel], check=True, capture_output=True, text=True).stdout
+        self.addrs, self.names = [], []
+        for line in out.splitlines():
+            fields = line.split()
+            if len(fields) == 3 and fields[1] in "tTwW":
+                self.addrs.append(int(fields[0], 16))
+                self.names.append(fields[2])
+
+    def lookup(self, addr):
+        """Returns the name of the function that contains the address, or None."""
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        return self.names[i] if i >= 0 else None
+
+    def format(self, addr):
+        """Returns the address as `symbol+offset`, or in hex if it is not in any function."""
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return "0x%08x" % addr
+        off = addr - self.addrs[i]
+        return self.names[i] if not off else "%s+0x%x" % (self.names[i], off)
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+#
+# Maps the samples of the kernel's sampling profiler (see include/sys/profile.h) onto the symbols of
+# the kernel ELF and prints where the time went, by function, by thread and by processor mode.
+#
+# Usage: prof_symbolize.py <capture> <kernel> [count]
+#
+# The capture is the serial output containing one or more dumps, which are written when the
+# profiler is stopped with Ctrl + P. All dumps in the capture are summed up. `count` limits the
+# number of functions printed (default 30).
+
+import collections
+import struct
+import sys
+
+from ksyms import Symbols
+
+
+MAGIC = b"PROF"
+HEADER = struct.Struct("<III")
+SAMPLE = struct.Struct("<IHH")
+
+MODES = {0x10: "usr", 0x11: "fiq", 0x12: "irq", 0x13: "svc", 0x17: "abt", 0x1B: "und", 0x1F: "sys"}
+
+
+def find_samples(data):
+    """Returns all samples of all complete dumps in the capture and the number of dropped ones."""
+    samples, lost = [], 0
+    pos = data.find(MAGIC)
+    while pos != -1 and pos + HEADER.size <= len(data):
+        _, dropped, count = HEADER.unpack_from(data, pos)
+        end = pos + HEADER.size + count * SAMPLE.size
+        if end <= len(data):
+            samples += [SAMPLE.unpack_from(data, pos + HEADER.size + i * SAMPLE.size)
+                        for i in range(count)]
+            lost += dropped
+            pos = data.find(MAGIC, end)
+        else:
+            pos = data.find(MAGIC, pos + 1)
+    return samples, lost
+
+
+def print_table(title, counter, total, limit=None):
+    print("%8s %7s  %s" % ("samples", "share", title))
+    for key, n in counter.most_common(limit):
+        print("%8d %6.2f%%  %s" % (n, 100.0 * n / total, key))
+    print()
+
+
+def main():
+    if len(sys.argv) not in (3, 4):
+        print("Usage: %s <capture> <kernel> [count]" % sys.argv[0], file=sys.stderr)
+        sys.exit(1)
+
+    with open(sys.argv[1], "rb") as f:
+        samples, lost = find_samples(f.read())
+    if not samples:
+        print("No profile dump found.", file=sys.stderr)
+        sys.exit(1)
+
+    symbols = Symbols(sys.argv[2])
+    limit = int(sys.argv[3]) if len(sys.argv) == 4 else 30
+
+    functions = collections.Counter()
+    threads = collections.Counter()
+    modes = collections.Counter()
+    for pc, tid, mode in samples:
+        functions["%s (%s)" % (symbols.lookup(pc) or "0x%08x" % pc, MODES.get(mode, hex(mode)))] += 1
+        threads["thread %d" % tid] += 1
+        modes[MODES.get(mode, hex(mode))] += 1
+
+    print("%d samples, %d dropped\n" % (len(samples), lost))
+    print_table("function (mode)", functions, len(samples), limit)
+    print_table("thread", threads, len(samples))
+    print_table("mode", modes, len(samples))
+
+
+if __name__ == "__main__":
+    main()
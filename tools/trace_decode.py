@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2018-2019 Tim Scheuermann, Julian Holzwarth, Adrian Herrmann
+#
+# Decodes the kernel's trace dumps (see include/sys/trace.h) from a capture of the serial output
+# and prints them as a timeline.
+#
+# Usage: trace_decode.py <capture> [kernel]
+#
+# The capture may contain any other output around the dumps. If the kernel ELF is given, IRQ
+# handler addresses are resolved to symbol names with `nm`.
+
+import struct
+import sys
+
+from ksyms import Symbols
+
+
+MAGIC = b"TRCE"
+HEADER = struct.Struct("<IIII")
+RECORD = struct.Struct("<IHHII")
+
+EVENTS = {
+    0x01: ("switch", lambda a0, a1, sym: "%d -> %d" % (a0, a1)),
+    0x02: ("irq", lambda a0, a1, sym: "%s nesting %d" % (sym(a0), a1)),
+    0x03: ("swi", lambda a0, a1, sym: "0x%02x at 0x%08x" % (a0, a1)),
+    0x04: ("swi_fast", lambda a0, a1, sym: "0x%02x" % a0),
+    0x05: ("wake", lambda a0, a1, sym: "thread %d" % a0),
+    0x06: ("defer", lambda a0, a1, sym: "pending 0x%x" % a0),
+    0x07: ("prefetch_abort", lambda a0, a1, sym: "at 0x%08x" % a0),
+    0x08: ("data_abort", lambda a0, a1, sym: "access 0x%08x at 0x%08x" % (a0, a1)),
+    0x09: ("page_alloc", lambda a0, a1, sym: "page %d" % a0),
+    0x0A: ("page_free", lambda a0, a1, sym: "page %d" % a0),
+    0x0B: ("map", lambda a0, a1, sym: "0x%08x -> page %d" % (a0, a1)),
+    0x0C: ("cow", lambda a0, a1, sym: "0x%08x -> page %d" % (a0, a1)),
+}
+
+
+def find_dumps(data):
+    """Yields the header fields and records of all complete dumps in the capture."""
+    pos = data.find(MAGIC)
+    while pos != -1 and pos + HEADER.size <= len(data):
+        _, total, count, clock_hz = HEADER.unpack_from(data, pos)
+        end = pos + HEADER.size + count * RECORD.size
+        if clock_hz and end <= len(data):
+            records = [RECORD.unpack_from(data, pos + HEADER.size + i * RECORD.size)
+                       for i in range(count)]
+            yield total, clock_hz, records
+            pos = data.find(MAGIC, end)
+        else:
+            pos = data.find(MAGIC, pos + 1)
+
+
+def print_timeline(total, clock_hz, records, sym):
+    print("%d records, %d lost" % (len(records), total - len(records)))
+    if not records:
+        return
+
+    # Timestamps are the lower 32 bits of the clock, so unwrap them relative to the first record
+    start = records[0][0]
+    for time, event, tid, arg0, arg1 in records:
+        us = ((time - start) & 0xFFFFFFFF) * 1000000 // clock_hz
+        name, fmt = EVENTS.get(event, ("0x%02x" % event, lambda a0, a1, sym: "0x%x 0x%x" % (a0, a1)))
+        print("%12d us  [%2d]  %-14s %s" % (us, tid, name, fmt(arg0, arg1, sym)))
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        print("Usage: %s <capture> [kernel]" % sys.argv[0], file=sys.stderr)
+        sys.exit(1)
+
+    with open(sys.argv[1], "rb") as f:
+        data = f.read()
+    sym = Symbols(sys.argv[2]).format if len(sys.argv) == 3 else lambda addr: "0x%08x" % addr
+
+    dumps = 0
+    for total, clock_hz, records in find_dumps(data):
+        if dumps:
+            print()
+        print_timeline(total, clock_hz, records, sym)
+        dumps += 1
+
+    if not dumps:
+        print("No trace dump found.", file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()